@@ -5,6 +5,20 @@
 
 #include "stm32h745xx.h"
 
+// hot code and data can be placed in the cortex-m7 tightly coupled memories, which run with zero wait states. The linker scripts
+// in stm32cubeh7/ld/CM7 place these sections and the startup code copies them in, stm32cubeh7/ld/tcm_map_report.py lists what
+// landed where from the map file. Dma can't reach dtcm, so dma buffers can't go there. The cortex-m4 can't reach either memory,
+// so these do nothing there
+#ifdef CORE_CM4
+#define LLPD_ITCM_FUNC
+#define LLPD_DTCM_DATA
+#define LLPD_DTCM_BSS
+#else
+#define LLPD_ITCM_FUNC __attribute__(( section(".itcm_text"), noinline ))
+#define LLPD_DTCM_DATA __attribute__(( section(".dtcm_data") ))
+#define LLPD_DTCM_BSS  __attribute__(( section(".dtcm_bss") )) // zero initialized data only
+#endif
+
 enum class GPIO_PORT
 {
 	A,
@@ -61,6 +75,176 @@ enum class GPIO_PUPD
 	PULL_DOWN
 };
 
+enum class GPIO_MODE
+{
+	INPUT    = 0b00,
+	OUTPUT   = 0b01,
+	ALT_FUNC = 0b10,
+	ANALOG   = 0b11
+};
+
+enum class GPIO_EXTI_EDGE
+{
+	RISING,
+	FALLING,
+	BOTH
+};
+
+struct GPIO_DEBOUNCE_EVENT
+{
+	GPIO_PORT port;
+	GPIO_PIN  pin;
+	bool      pressed; // false if released
+};
+
+// gpio ports are evenly spaced in memory, so port pointers and pin masks can be computed instead of looked up
+constexpr uint32_t GPIO_PORT_ADDRESS_SPACING = GPIOB_BASE - GPIOA_BASE;
+
+constexpr uint32_t gpio_port_address (const GPIO_PORT& port)
+{
+	return GPIOA_BASE + ( static_cast<uint32_t>(port) * GPIO_PORT_ADDRESS_SPACING );
+}
+
+constexpr uint32_t gpio_pin_mask (const GPIO_PIN& pin)
+{
+	return 1UL << static_cast<uint32_t>( pin );
+}
+
+// each core has its own exti interrupt mask and pending registers
+inline EXTI_Core_TypeDef* exti_current_core()
+{
+#ifdef CORE_CM4
+	return EXTI_D2;
+#else
+	return EXTI_D1;
+#endif
+}
+
+// BSRR value that drives a numBits wide field starting at firstPin to value in a single write
+constexpr uint32_t gpio_range_bsrr_value (const GPIO_PIN& firstPin, const unsigned int numBits, const uint32_t value)
+{
+	const uint32_t fieldMask = ( (numBits >= 16) ? 0xFFFFUL : ((1UL << numBits) - 1) ) << static_cast<uint32_t>( firstPin );
+	const uint32_t shiftedVal = value << static_cast<uint32_t>( firstPin );
+
+	return ( shiftedVal & fieldMask ) | ( (~shiftedVal & fieldMask) << 16 );
+}
+
+// one entry of a board pin map (see PinMap below)
+struct GPIO_PIN_CONFIG
+{
+	GPIO_PORT         port;
+	GPIO_PIN          pin;
+	GPIO_MODE         mode;
+	GPIO_PUPD         pupd       = GPIO_PUPD::NONE;
+	GPIO_OUTPUT_TYPE  type       = GPIO_OUTPUT_TYPE::PUSH_PULL; // only used for outputs and alternate functions
+	GPIO_OUTPUT_SPEED speed      = GPIO_OUTPUT_SPEED::LOW;      // only used for outputs and alternate functions
+	uint8_t           afValue    = 0;                           // only used for alternate functions
+	bool              outputHigh = false;                       // initial level, only used for outputs
+};
+
+// register values and masks of the pins in a pin map that belong to one port, bits outside the masks are left untouched
+struct GPIO_PORT_IMAGE
+{
+	uint32_t moder       = 0;
+	uint32_t moderMask   = 0;
+	uint32_t otyper      = 0;
+	uint32_t otyperMask  = 0;
+	uint32_t ospeedr     = 0;
+	uint32_t ospeedrMask = 0;
+	uint32_t pupdr       = 0;
+	uint32_t pupdrMask   = 0;
+	uint32_t afr[2]      = { 0, 0 };
+	uint32_t afrMask[2]  = { 0, 0 };
+	uint32_t bsrr        = 0;
+};
+
+constexpr bool gpio_pin_map_has_conflicts (const GPIO_PIN_CONFIG* pinMap, const unsigned int numPins)
+{
+	for ( unsigned int first = 0; first < numPins; first++ )
+	{
+		for ( unsigned int second = first + 1; second < numPins; second++ )
+		{
+			if ( pinMap[first].port == pinMap[second].port && pinMap[first].pin == pinMap[second].pin )
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+constexpr bool gpio_pin_map_has_invalid_af (const GPIO_PIN_CONFIG* pinMap, const unsigned int numPins)
+{
+	for ( unsigned int pinNum = 0; pinNum < numPins; pinNum++ )
+	{
+		if ( pinMap[pinNum].afValue > 15 )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+constexpr GPIO_PORT_IMAGE gpio_pin_map_port_image (const GPIO_PIN_CONFIG* pinMap, const unsigned int numPins, const GPIO_PORT& port)
+{
+	GPIO_PORT_IMAGE image;
+
+	for ( unsigned int entry = 0; entry < numPins; entry++ )
+	{
+		const GPIO_PIN_CONFIG& conf = pinMap[entry];
+		if ( conf.port != port )
+		{
+			continue;
+		}
+
+		const uint32_t pinNum = static_cast<uint32_t>( conf.pin );
+		const uint32_t twoBitShift = pinNum * 2;
+
+		image.moder |= static_cast<uint32_t>( conf.mode ) << twoBitShift;
+		image.moderMask |= 0b11UL << twoBitShift;
+
+		image.pupdr |= static_cast<uint32_t>( conf.pupd ) << twoBitShift;
+		image.pupdrMask |= 0b11UL << twoBitShift;
+
+		if ( conf.mode == GPIO_MODE::OUTPUT || conf.mode == GPIO_MODE::ALT_FUNC )
+		{
+			image.otyper |= static_cast<uint32_t>( conf.type ) << pinNum;
+			image.otyperMask |= 1UL << pinNum;
+
+			image.ospeedr |= static_cast<uint32_t>( conf.speed ) << twoBitShift;
+			image.ospeedrMask |= 0b11UL << twoBitShift;
+		}
+
+		if ( conf.mode == GPIO_MODE::ALT_FUNC )
+		{
+			const uint32_t afShift = ( pinNum % 8 ) * 4; // 4 is the width of the alternate function pin value
+			image.afr[pinNum / 8] |= static_cast<uint32_t>( conf.afValue & 0b1111 ) << afShift;
+			image.afrMask[pinNum / 8] |= 0b1111UL << afShift;
+		}
+
+		if ( conf.mode == GPIO_MODE::OUTPUT )
+		{
+			image.bsrr |= ( conf.outputHigh ) ? ( 1UL << pinNum ) : ( 1UL << (pinNum + 16) );
+		}
+	}
+
+	return image;
+}
+
+constexpr uint32_t gpio_pin_map_clock_mask (const GPIO_PIN_CONFIG* pinMap, const unsigned int numPins)
+{
+	uint32_t clockMask = 0;
+
+	for ( unsigned int entry = 0; entry < numPins; entry++ )
+	{
+		clockMask |= RCC_AHB4ENR_GPIOAEN << static_cast<uint32_t>( pinMap[entry].port ); // port enable bits are contiguous
+	}
+
+	return clockMask;
+}
+
 enum class ADC_NUM
 {
 	ADC_1_2,
@@ -104,6 +288,61 @@ enum class ADC_CHANNEL
 	CHAN_INVALID
 };
 
+constexpr unsigned int ADC_NUM_CHANNELS = static_cast<unsigned int>( ADC_CHANNEL::CHAN_INVALID );
+constexpr uint8_t ADC_CHANNEL_NO_RANK = 0xFF; // the channel isn't in the sequence
+
+// external triggers for regular conversions, values are the EXTSEL register values
+enum class ADC_TRIGGER
+{
+	TIM1_OC1   = 0,
+	TIM1_OC2   = 1,
+	TIM1_OC3   = 2,
+	TIM2_OC2   = 3,
+	TIM3_TRGO  = 4,
+	TIM4_OC4   = 5,
+	EXTI_11    = 6,
+	TIM8_TRGO  = 7,
+	TIM8_TRGO2 = 8,
+	TIM1_TRGO  = 9,
+	TIM1_TRGO2 = 10,
+	TIM2_TRGO  = 11,
+	TIM4_TRGO  = 12,
+	TIM6_TRGO  = 13,
+	TIM15_TRGO = 14,
+	TIM3_OC4   = 15,
+	LPTIM1_OUT = 18,
+	LPTIM2_OUT = 19,
+	LPTIM3_OUT = 20
+};
+
+// RES register values (for revision V silicon)
+enum class ADC_RESOLUTION
+{
+	BITS_16 = 0b000,
+	BITS_14 = 0b101,
+	BITS_12 = 0b110,
+	BITS_10 = 0b011,
+	BITS_8  = 0b111
+};
+
+enum class ADC_OVERSAMPLING_MODE
+{
+	CONTINUED, 	// every conversion for a result runs from one trigger, injected conversions pause the accumulation
+	RESUMED, 	// the same, but injected conversions restart the accumulation
+	TRIGGERED 	// every conversion for a result needs its own trigger
+};
+
+constexpr unsigned int ADC_MAX_OVERSAMPLING_RATIO = 1024;
+constexpr uint8_t ADC_MAX_OVERSAMPLING_SHIFT = 11;
+
+enum class ADC_TRIGGER_EDGE
+{
+	SOFTWARE = 0b00, 	// conversions start on ADSTART, the trigger is ignored
+	RISING   = 0b01,
+	FALLING  = 0b10,
+	BOTH     = 0b11
+};
+
 enum class SPI_NUM
 {
 	SPI_1,
@@ -277,6 +516,13 @@ enum class FMC_SDRAM_RPIPE_DELAY
 	CYCLES_2 = 0b10,
 };
 
+enum class FMC_SDRAM_POWER_MODE
+{
+	NORMAL,
+	SELF_REFRESH, 	// the sdram refreshes itself, so the fmc clock can stop
+	POWER_DOWN 	// faster to exit, but the fmc still wakes the sdram for every auto-refresh
+};
+
 enum class LTDC_HSYNC_POL
 {
 	ACTIVE_LOW  = 0,
@@ -349,9 +595,814 @@ enum class SDMMC_CLK_EDGE
 	FALLING = 0b1
 };
 
-constexpr unsigned int D3_SRAM_TIM6_OFFSET_IN_BYTES = sizeof(float) * 3 + sizeof(uint32_t);
-constexpr unsigned int D3_SRAM_ADC_OFFSET_IN_BYTES = D3_SRAM_TIM6_OFFSET_IN_BYTES + ( sizeof(uint32_t) * 32 ) + ( sizeof(ADC_CHANNEL) * 32 );
-constexpr unsigned int D3_SRAM_UNUSED_OFFSET_IN_BYTES = D3_SRAM_TIM6_OFFSET_IN_BYTES + D3_SRAM_ADC_OFFSET_IN_BYTES;
+enum class RCC_PLL_NUM
+{
+	PLL_1,
+	PLL_2,
+	PLL_3
+};
+
+enum class PWR_LOW_POWER_MODE
+{
+	CSLEEP, 	// core clock stopped, peripherals keep running
+	CSTOP, 		// core and domain bus clocks stopped, d3 is kept running so the system doesn't enter stop
+	DSTOP 		// same as cstop, but the domains and system enter stop when the other core allows it (hse and plls are restored on wakeup)
+};
+
+// clocks that can be queried at runtime with rcc_get_clock_freq
+enum class RCC_CLOCK
+{
+	HSI,
+	CSI,
+	HSE,
+	LSE,
+	PER, 		// per_ck
+	PLL1_P,
+	PLL1_Q,
+	PLL1_R,
+	PLL2_P,
+	PLL2_Q,
+	PLL2_R,
+	PLL3_P,
+	PLL3_Q,
+	PLL3_R,
+	SYS, 		// sys_ck
+	CPU1, 		// sys_d1cpre_ck
+	AHB, 		// hclk, also cpu2
+	APB1,
+	APB2,
+	APB3,
+	APB4,
+	APB1_TIMER,
+	APB2_TIMER
+};
+
+constexpr uint32_t RCC_HSI_FREQ = 64000000;
+constexpr uint32_t RCC_CSI_FREQ = 4000000;
+constexpr uint32_t RCC_LSE_FREQ = 32768;
+
+// pll settings, the vco frequency is srcFreq / divM * ( divN + fracN / 8192 ) and each output is the vco frequency / its divider
+struct RCC_PLL_CONFIG
+{
+	uint32_t divM       = 1; 		// 1 - 63
+	uint32_t divN       = 4; 		// 4 - 512
+	uint32_t fracN      = 0; 		// 0 - 8191, 0 leaves the pll in integer mode
+	uint32_t divP       = 0; 		// 1 - 128 (pll1 only allows even values), 0 leaves the output disabled
+	uint32_t divQ       = 0; 		// 1 - 128, 0 leaves the output disabled
+	uint32_t divR       = 0; 		// 1 - 128, 0 leaves the output disabled
+	uint32_t inputRange = 0; 		// PLLxRGE value for the reference clock (srcFreq / divM)
+	bool     mediumVco  = false; 	// PLLxVCOSEL value, medium is 150 - 420 MHz, wide is 192 - 960 MHz
+	uint64_t errorHz    = 0; 		// sum of the errors of the requested outputs
+	bool     valid      = false;
+};
+
+// system clock settings for cpu1, the bus frequencies are derived from the pll1 p output (sys_ck)
+struct RCC_CLOCK_CONFIG
+{
+	RCC_PLL_CONFIG pll1;
+	uint32_t       hseFreq = 0;
+	uint32_t       sysFreq = 0;
+	uint32_t       ahbFreq = 0; 	// also the cpu2 and flash (aclk) frequency
+	uint32_t       apbFreq = 0; 	// every apb bus uses the same prescaler
+	uint32_t       hpre    = 0; 	// D1CFGR HPRE value
+	uint32_t       ppre    = 0; 	// D1PPRE, D2PPRE1, D2PPRE2 and D3PPRE value
+	bool           valid   = false;
+};
+
+constexpr uint32_t RCC_PLL_REF_MIN_FREQ        = 1000000;
+constexpr uint32_t RCC_PLL_REF_MAX_FREQ        = 16000000;
+constexpr uint32_t RCC_PLL_FRAC_REF_MIN_FREQ   = 2000000;
+constexpr uint32_t RCC_PLL_WIDE_VCO_MIN_FREQ   = 192000000;
+constexpr uint32_t RCC_PLL_WIDE_VCO_MAX_FREQ   = 960000000;
+constexpr uint32_t RCC_PLL_MEDIUM_VCO_MIN_FREQ = 150000000;
+constexpr uint32_t RCC_PLL_MEDIUM_VCO_MAX_FREQ = 420000000;
+constexpr uint32_t RCC_PLL_FRAC_SCALE          = 8192;
+constexpr uint32_t RCC_MAX_SYS_FREQ            = 480000000;
+constexpr uint32_t RCC_MAX_AHB_FREQ            = 240000000;
+constexpr uint32_t RCC_MAX_APB_FREQ            = 120000000;
+
+constexpr uint64_t rcc_abs_diff (const uint64_t a, const uint64_t b)
+{
+	return ( a > b ) ? ( a - b ) : ( b - a );
+}
+
+// frequency of a pll output with the given divider, nScaled is divN * 8192 + fracN
+constexpr uint32_t rcc_pll_output_freq (const uint32_t srcFreq, const uint32_t divM, const uint64_t nScaled, const uint32_t div)
+{
+	return ( div == 0 ) ? 0 : static_cast<uint32_t>( (static_cast<uint64_t>(srcFreq) * nScaled)
+								/ (static_cast<uint64_t>(divM) * RCC_PLL_FRAC_SCALE * div) );
+}
+
+// closest output divider to the target frequency (0 if the output isn't requested)
+constexpr uint32_t rcc_pll_closest_div (const uint32_t srcFreq, const uint32_t divM, const uint64_t nScaled, const uint32_t targetFreq,
+					const bool evenOnly)
+{
+	if ( targetFreq == 0 )
+	{
+		return 0;
+	}
+
+	const uint64_t vcoTimesDenominator = static_cast<uint64_t>( srcFreq ) * nScaled;
+	const uint64_t targetTimesDenominator = static_cast<uint64_t>( targetFreq ) * divM * RCC_PLL_FRAC_SCALE;
+	uint64_t div = ( vcoTimesDenominator + (targetTimesDenominator / 2) ) / targetTimesDenominator;
+
+	if ( evenOnly && (div % 2) != 0 )
+	{
+		// pick whichever even neighbour is closer
+		const uint32_t lowerFreq = rcc_pll_output_freq( srcFreq, divM, nScaled, (div > 1) ? div - 1 : 2 );
+		const uint32_t upperFreq = rcc_pll_output_freq( srcFreq, divM, nScaled, div + 1 );
+		div = ( div > 1 && rcc_abs_diff(lowerFreq, targetFreq) <= rcc_abs_diff(upperFreq, targetFreq) ) ? div - 1 : div + 1;
+	}
+
+	const uint32_t minDiv = ( evenOnly ) ? 2 : 1;
+	return ( div < minDiv ) ? minDiv : ( (div > 128) ? 128 : static_cast<uint32_t>(div) );
+}
+
+// searches every legal divM, vco range and primary output divider for the pll settings closest to the requested outputs
+// (integer mode is preferred when it's as accurate as fractional mode), targets of 0 leave that output disabled
+constexpr RCC_PLL_CONFIG rcc_solve_pll (const RCC_PLL_NUM& pllNum, const uint32_t srcFreq, const uint32_t targetP, const uint32_t targetQ = 0,
+					const uint32_t targetR = 0, const uint32_t maxErrorHz = 0)
+{
+	RCC_PLL_CONFIG best;
+	best.errorHz = UINT64_MAX;
+
+	const bool pEvenOnly = ( pllNum == RCC_PLL_NUM::PLL_1 );
+
+	// the vco is placed to hit the first requested output, the other outputs use their closest dividers
+	const uint32_t primaryFreq = ( targetP != 0 ) ? targetP : ( (targetQ != 0) ? targetQ : targetR );
+	const bool primaryEvenOnly = ( targetP != 0 ) && pEvenOnly;
+	if ( primaryFreq == 0 || srcFreq == 0 )
+	{
+		return best;
+	}
+
+	for ( uint32_t divM = 1; divM <= 63; divM++ )
+	{
+		if ( srcFreq < static_cast<uint64_t>(divM) * RCC_PLL_REF_MIN_FREQ )
+		{
+			break;
+		}
+		if ( srcFreq > static_cast<uint64_t>(divM) * RCC_PLL_REF_MAX_FREQ )
+		{
+			continue;
+		}
+
+		const uint32_t refFreq = srcFreq / divM;
+		const uint32_t inputRange = ( refFreq < 2000000 ) ? 0 : ( (refFreq < 4000000) ? 1 : ((refFreq < 8000000) ? 2 : 3) );
+
+		for ( int vcoSel = 0; vcoSel <= 1; vcoSel++ )
+		{
+			const bool mediumVco = ( vcoSel == 1 );
+
+			// the wide vco range can't be used with a 1 - 2 MHz reference
+			if ( ! mediumVco && inputRange == 0 )
+			{
+				continue;
+			}
+
+			const uint32_t vcoMin = ( mediumVco ) ? RCC_PLL_MEDIUM_VCO_MIN_FREQ : RCC_PLL_WIDE_VCO_MIN_FREQ;
+			const uint32_t vcoMax = ( mediumVco ) ? RCC_PLL_MEDIUM_VCO_MAX_FREQ : RCC_PLL_WIDE_VCO_MAX_FREQ;
+
+			for ( uint32_t primaryDiv = (primaryEvenOnly) ? 2 : 1; primaryDiv <= 128; primaryDiv += (primaryEvenOnly) ? 2 : 1 )
+			{
+				const uint64_t vcoTarget = static_cast<uint64_t>( primaryFreq ) * primaryDiv;
+				if ( vcoTarget < vcoMin )
+				{
+					continue;
+				}
+				if ( vcoTarget > vcoMax )
+				{
+					break;
+				}
+
+				// vco = srcFreq * nScaled / ( divM * 8192 ), rounded to the nearest fractional step
+				const uint64_t nScaled = ( (vcoTarget * divM * RCC_PLL_FRAC_SCALE) + (srcFreq / 2) ) / srcFreq;
+				const uint32_t divN = nScaled / RCC_PLL_FRAC_SCALE;
+				const uint32_t fracN = nScaled % RCC_PLL_FRAC_SCALE;
+
+				if ( divN < 4 || divN > 512 )
+				{
+					continue;
+				}
+				if ( fracN != 0 && (refFreq < RCC_PLL_FRAC_REF_MIN_FREQ || divN < 8 || divN > 420) )
+				{
+					continue;
+				}
+
+				const uint32_t divP = rcc_pll_closest_div( srcFreq, divM, nScaled, targetP, pEvenOnly );
+				const uint32_t divQ = rcc_pll_closest_div( srcFreq, divM, nScaled, targetQ, false );
+				const uint32_t divR = rcc_pll_closest_div( srcFreq, divM, nScaled, targetR, false );
+
+				const uint64_t errorHz = rcc_abs_diff( rcc_pll_output_freq(srcFreq, divM, nScaled, divP), targetP )
+							+ rcc_abs_diff( rcc_pll_output_freq(srcFreq, divM, nScaled, divQ), targetQ )
+							+ rcc_abs_diff( rcc_pll_output_freq(srcFreq, divM, nScaled, divR), targetR );
+
+				const bool isBetter = ( errorHz < best.errorHz ) || ( errorHz == best.errorHz && fracN == 0 && best.fracN != 0 );
+				if ( isBetter )
+				{
+					best.divM = divM;
+					best.divN = divN;
+					best.fracN = fracN;
+					best.divP = divP;
+					best.divQ = divQ;
+					best.divR = divR;
+					best.inputRange = inputRange;
+					best.mediumVco = mediumVco;
+					best.errorHz = errorHz;
+				}
+			}
+		}
+	}
+
+	best.valid = ( best.errorHz <= maxErrorHz );
+
+	return best;
+}
+
+constexpr uint32_t rcc_pll_freq (const uint32_t srcFreq, const RCC_PLL_CONFIG& config, const uint32_t div)
+{
+	return rcc_pll_output_freq( srcFreq, config.divM, (static_cast<uint64_t>(config.divN) * RCC_PLL_FRAC_SCALE) + config.fracN, div );
+}
+
+// D1CFGR HPRE value for an ahb divider, or 0xFFFFFFFF if the divider isn't available
+constexpr uint32_t rcc_hpre_value (const uint32_t div)
+{
+	return ( div == 1 ) ? 0b0000 : ( div == 2 ) ? 0b1000 : ( div == 4 ) ? 0b1001 : ( div == 8 ) ? 0b1010 : ( div == 16 ) ? 0b1011
+		: ( div == 64 ) ? 0b1100 : ( div == 128 ) ? 0b1101 : ( div == 256 ) ? 0b1110 : ( div == 512 ) ? 0b1111 : 0xFFFFFFFF;
+}
+
+// D1PPRE/D2PPRE1/D2PPRE2/D3PPRE value for an apb divider, or 0xFFFFFFFF if the divider isn't available
+constexpr uint32_t rcc_ppre_value (const uint32_t div)
+{
+	return ( div == 1 ) ? 0b000 : ( div == 2 ) ? 0b100 : ( div == 4 ) ? 0b101 : ( div == 8 ) ? 0b110 : ( div == 16 ) ? 0b111
+		: 0xFFFFFFFF;
+}
+
+// solves pll1 and the bus prescalers for cpu1 from the hse frequency, pll1 q and r are optional peripheral kernel clocks
+constexpr RCC_CLOCK_CONFIG rcc_solve_clocks (const uint32_t hseFreq, const uint32_t sysFreq, const uint32_t ahbFreq, const uint32_t apbFreq,
+						const uint32_t pll1qFreq = 0, const uint32_t pll1rFreq = 0, const uint32_t maxErrorHz = 0)
+{
+	RCC_CLOCK_CONFIG config;
+	config.pll1 = rcc_solve_pll( RCC_PLL_NUM::PLL_1, hseFreq, sysFreq, pll1qFreq, pll1rFreq, maxErrorHz );
+	config.hseFreq = hseFreq;
+	config.sysFreq = rcc_pll_freq( hseFreq, config.pll1, config.pll1.divP );
+
+	const uint32_t ahbDiv = ( ahbFreq != 0 && sysFreq % ahbFreq == 0 ) ? sysFreq / ahbFreq : 0;
+	const uint32_t apbDiv = ( apbFreq != 0 && ahbFreq % apbFreq == 0 ) ? ahbFreq / apbFreq : 0;
+	config.hpre = rcc_hpre_value( ahbDiv );
+	config.ppre = rcc_ppre_value( apbDiv );
+	config.ahbFreq = ( ahbDiv != 0 ) ? config.sysFreq / ahbDiv : 0;
+	config.apbFreq = ( apbDiv != 0 ) ? config.ahbFreq / apbDiv : 0;
+
+	config.valid = config.pll1.valid && config.hpre != 0xFFFFFFFF && config.ppre != 0xFFFFFFFF && sysFreq <= RCC_MAX_SYS_FREQ
+			&& ahbFreq <= RCC_MAX_AHB_FREQ && apbFreq <= RCC_MAX_APB_FREQ;
+
+	return config;
+}
+
+// peripherals in the descriptor table below (the order of both must match)
+enum class PERIPH
+{
+	SYS_CFG,
+	HW_SEM,
+	DMA_1,
+	DMA_2,
+	BDMA_1,
+	ADC_1_2,
+	ADC_3,
+	DAC_1,
+	OPAMP_1_2,
+	TIM_6,
+	TIM_7,
+	TIM_15,
+	LPTIM_1,
+	SPI_1,
+	SPI_2,
+	SPI_3,
+	SPI_4,
+	SPI_5,
+	SPI_6,
+	I2C_1,
+	I2C_2,
+	I2C_3,
+	I2C_4,
+	USART_1,
+	USART_2,
+	USART_3,
+	USART_6,
+	FMC,
+	LTDC_1,
+	SDMMC_1,
+	NUM_PERIPHS
+};
+
+enum class RCC_BUS
+{
+	AHB1,
+	AHB2,
+	AHB3,
+	AHB4,
+	APB1L,
+	APB1H,
+	APB2,
+	APB3,
+	APB4
+};
+
+constexpr int16_t PERIPH_NO_IRQN = 0x7FFF;
+constexpr uint8_t PERIPH_NO_DMA_REQ = 0; // dmamux request 0 is unused
+
+struct PERIPH_DESC
+{
+	PERIPH   periph;
+	uint32_t baseAddress;
+	RCC_BUS  bus;
+	uint32_t enableMask; 	// bit in the xxxENR register for the bus
+	uint32_t resetMask; 	// bit in the xxxRSTR register for the bus
+	uint32_t lpEnableMask; 	// bit in the xxxLPENR register for the bus (clock during csleep)
+	int16_t  irqn;
+	uint8_t  dmaReqRx; 	// peripheral to memory dmamux request (adc data)
+	uint8_t  dmaReqTx; 	// memory to peripheral dmamux request (dac channel 1 and timer update)
+	bool     onDmamux2; 	// d3 peripherals use dmamux2 and the bdma
+};
+
+#ifdef CORE_CM4
+constexpr int16_t HSEM_IRQN_CURRENT = HSEM2_IRQn;
+#else
+constexpr int16_t HSEM_IRQN_CURRENT = HSEM1_IRQn;
+#endif
+
+constexpr PERIPH_DESC PERIPH_DESCS[] =
+{
+	{ PERIPH::SYS_CFG, SYSCFG_BASE,  RCC_BUS::APB4,  RCC_APB4ENR_SYSCFGEN,  RCC_APB4RSTR_SYSCFGRST,  RCC_APB4LPENR_SYSCFGLPEN,
+		PERIPH_NO_IRQN,    PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::HW_SEM,  HSEM_BASE,    RCC_BUS::AHB4,  RCC_AHB4ENR_HSEMEN,    RCC_AHB4RSTR_HSEMRST,    0,
+		HSEM_IRQN_CURRENT, PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::DMA_1,   DMA1_BASE,    RCC_BUS::AHB1,  RCC_AHB1ENR_DMA1EN,    RCC_AHB1RSTR_DMA1RST,    RCC_AHB1LPENR_DMA1LPEN,
+		PERIPH_NO_IRQN,    PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::DMA_2,   DMA2_BASE,    RCC_BUS::AHB1,  RCC_AHB1ENR_DMA2EN,    RCC_AHB1RSTR_DMA2RST,    RCC_AHB1LPENR_DMA2LPEN,
+		PERIPH_NO_IRQN,    PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::BDMA_1,  BDMA_BASE,    RCC_BUS::AHB4,  RCC_AHB4ENR_BDMAEN,    RCC_AHB4RSTR_BDMARST,    RCC_AHB4LPENR_BDMALPEN,
+		PERIPH_NO_IRQN,    PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, true  },
+	{ PERIPH::ADC_1_2, ADC1_BASE,    RCC_BUS::AHB1,  RCC_AHB1ENR_ADC12EN,   RCC_AHB1RSTR_ADC12RST,   RCC_AHB1LPENR_ADC12LPEN,
+		ADC_IRQn,          9,                 PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::ADC_3,   ADC3_BASE,    RCC_BUS::AHB4,  RCC_AHB4ENR_ADC3EN,    RCC_AHB4RSTR_ADC3RST,    RCC_AHB4LPENR_ADC3LPEN,
+		ADC3_IRQn,         17,                PERIPH_NO_DMA_REQ, true  },
+	{ PERIPH::DAC_1,   DAC1_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_DAC12EN,  RCC_APB1LRSTR_DAC12RST,  RCC_APB1LLPENR_DAC12LPEN,
+		TIM6_DAC_IRQn,     PERIPH_NO_DMA_REQ, 67,                false },
+	{ PERIPH::OPAMP_1_2, OPAMP_BASE, RCC_BUS::APB1H, RCC_APB1HENR_OPAMPEN,  RCC_APB1HRSTR_OPAMPRST,  RCC_APB1HLPENR_OPAMPLPEN,
+		PERIPH_NO_IRQN,    PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::TIM_6,   TIM6_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_TIM6EN,   RCC_APB1LRSTR_TIM6RST,   RCC_APB1LLPENR_TIM6LPEN,
+		TIM6_DAC_IRQn,     PERIPH_NO_DMA_REQ, 69,                false },
+	{ PERIPH::TIM_7,   TIM7_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_TIM7EN,   RCC_APB1LRSTR_TIM7RST,   RCC_APB1LLPENR_TIM7LPEN,
+		TIM7_IRQn,         PERIPH_NO_DMA_REQ, 70,                false },
+	{ PERIPH::TIM_15,  TIM15_BASE,   RCC_BUS::APB2,  RCC_APB2ENR_TIM15EN,   RCC_APB2RSTR_TIM15RST,   RCC_APB2LPENR_TIM15LPEN,
+		TIM15_IRQn,        PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::LPTIM_1, LPTIM1_BASE,  RCC_BUS::APB1L, RCC_APB1LENR_LPTIM1EN, RCC_APB1LRSTR_LPTIM1RST, RCC_APB1LLPENR_LPTIM1LPEN,
+		LPTIM1_IRQn,       PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::SPI_1,   SPI1_BASE,    RCC_BUS::APB2,  RCC_APB2ENR_SPI1EN,    RCC_APB2RSTR_SPI1RST,    RCC_APB2LPENR_SPI1LPEN,
+		SPI1_IRQn,         37,                38,                false },
+	{ PERIPH::SPI_2,   SPI2_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_SPI2EN,   RCC_APB1LRSTR_SPI2RST,   RCC_APB1LLPENR_SPI2LPEN,
+		SPI2_IRQn,         39,                40,                false },
+	{ PERIPH::SPI_3,   SPI3_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_SPI3EN,   RCC_APB1LRSTR_SPI3RST,   RCC_APB1LLPENR_SPI3LPEN,
+		SPI3_IRQn,         61,                62,                false },
+	{ PERIPH::SPI_4,   SPI4_BASE,    RCC_BUS::APB2,  RCC_APB2ENR_SPI4EN,    RCC_APB2RSTR_SPI4RST,    RCC_APB2LPENR_SPI4LPEN,
+		SPI4_IRQn,         83,                84,                false },
+	{ PERIPH::SPI_5,   SPI5_BASE,    RCC_BUS::APB2,  RCC_APB2ENR_SPI5EN,    RCC_APB2RSTR_SPI5RST,    RCC_APB2LPENR_SPI5LPEN,
+		SPI5_IRQn,         85,                86,                false },
+	{ PERIPH::SPI_6,   SPI6_BASE,    RCC_BUS::APB4,  RCC_APB4ENR_SPI6EN,    RCC_APB4RSTR_SPI6RST,    RCC_APB4LPENR_SPI6LPEN,
+		SPI6_IRQn,         11,                12,                true  },
+	{ PERIPH::I2C_1,   I2C1_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_I2C1EN,   RCC_APB1LRSTR_I2C1RST,   RCC_APB1LLPENR_I2C1LPEN,
+		I2C1_EV_IRQn,      33,                34,                false },
+	{ PERIPH::I2C_2,   I2C2_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_I2C2EN,   RCC_APB1LRSTR_I2C2RST,   RCC_APB1LLPENR_I2C2LPEN,
+		I2C2_EV_IRQn,      35,                36,                false },
+	{ PERIPH::I2C_3,   I2C3_BASE,    RCC_BUS::APB1L, RCC_APB1LENR_I2C3EN,   RCC_APB1LRSTR_I2C3RST,   RCC_APB1LLPENR_I2C3LPEN,
+		I2C3_EV_IRQn,      73,                74,                false },
+	{ PERIPH::I2C_4,   I2C4_BASE,    RCC_BUS::APB4,  RCC_APB4ENR_I2C4EN,    RCC_APB4RSTR_I2C4RST,    RCC_APB4LPENR_I2C4LPEN,
+		I2C4_EV_IRQn,      13,                14,                true  },
+	{ PERIPH::USART_1, USART1_BASE,  RCC_BUS::APB2,  RCC_APB2ENR_USART1EN,  RCC_APB2RSTR_USART1RST,  RCC_APB2LPENR_USART1LPEN,
+		USART1_IRQn,       41,                42,                false },
+	{ PERIPH::USART_2, USART2_BASE,  RCC_BUS::APB1L, RCC_APB1LENR_USART2EN, RCC_APB1LRSTR_USART2RST, RCC_APB1LLPENR_USART2LPEN,
+		USART2_IRQn,       43,                44,                false },
+	{ PERIPH::USART_3, USART3_BASE,  RCC_BUS::APB1L, RCC_APB1LENR_USART3EN, RCC_APB1LRSTR_USART3RST, RCC_APB1LLPENR_USART3LPEN,
+		USART3_IRQn,       45,                46,                false },
+	{ PERIPH::USART_6, USART6_BASE,  RCC_BUS::APB2,  RCC_APB2ENR_USART6EN,  RCC_APB2RSTR_USART6RST,  RCC_APB2LPENR_USART6LPEN,
+		USART6_IRQn,       71,                72,                false },
+	{ PERIPH::FMC,     FMC_R_BASE,   RCC_BUS::AHB3,  RCC_AHB3ENR_FMCEN,     RCC_AHB3RSTR_FMCRST,     RCC_AHB3LPENR_FMCLPEN,
+		FMC_IRQn,          PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::LTDC_1,  LTDC_BASE,    RCC_BUS::APB3,  RCC_APB3ENR_LTDCEN,    RCC_APB3RSTR_LTDCRST,    RCC_APB3LPENR_LTDCLPEN,
+		LTDC_IRQn,         PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false },
+	{ PERIPH::SDMMC_1, SDMMC1_BASE,  RCC_BUS::AHB3,  RCC_AHB3ENR_SDMMC1EN,  RCC_AHB3RSTR_SDMMC1RST,  RCC_AHB3LPENR_SDMMC1LPEN,
+		SDMMC1_IRQn,       PERIPH_NO_DMA_REQ, PERIPH_NO_DMA_REQ, false }
+};
+
+constexpr unsigned int NUM_PERIPHS = static_cast<unsigned int>( PERIPH::NUM_PERIPHS );
+
+constexpr bool periph_descs_in_order (const unsigned int index = 0)
+{
+	return ( index == NUM_PERIPHS ) || ( static_cast<unsigned int>(PERIPH_DESCS[index].periph) == index && periph_descs_in_order(index + 1) );
+}
+
+static_assert( sizeof(PERIPH_DESCS) / sizeof(PERIPH_DESC) == NUM_PERIPHS, "Every peripheral needs a descriptor" );
+static_assert( periph_descs_in_order(), "Peripheral descriptors must be in the same order as the PERIPH enum" );
+
+constexpr const PERIPH_DESC& periph_desc (const PERIPH& periph)
+{
+	return PERIPH_DESCS[static_cast<unsigned int>( periph )];
+}
+
+// the driver number enums are in the same order as their peripherals
+constexpr PERIPH periph_from_adc (const ADC_NUM& adcNum)
+{
+	return static_cast<PERIPH>( static_cast<unsigned int>(PERIPH::ADC_1_2) + static_cast<unsigned int>(adcNum) );
+}
+
+constexpr PERIPH periph_from_spi (const SPI_NUM& spiNum)
+{
+	return static_cast<PERIPH>( static_cast<unsigned int>(PERIPH::SPI_1) + static_cast<unsigned int>(spiNum) );
+}
+
+constexpr PERIPH periph_from_i2c (const I2C_NUM& i2cNum)
+{
+	return static_cast<PERIPH>( static_cast<unsigned int>(PERIPH::I2C_1) + static_cast<unsigned int>(i2cNum) );
+}
+
+constexpr PERIPH periph_from_usart (const USART_NUM& usartNum)
+{
+	return static_cast<PERIPH>( static_cast<unsigned int>(PERIPH::USART_1) + static_cast<unsigned int>(usartNum) );
+}
+
+constexpr uint32_t CACHE_LINE_SIZE = 32; // cortex-m7 d-cache line, dma buffers should be aligned to and sized in multiples of this
+
+enum class MPU_MEMORY_TYPE
+{
+	CACHEABLE_WRITE_BACK, 		// normal memory, read and write allocate
+	CACHEABLE_WRITE_THROUGH, 	// normal memory, no write allocate, so cpu writes always reach memory
+	NON_CACHEABLE, 			// shareable normal memory
+	DEVICE 				// shareable device memory, accesses aren't merged or made speculatively
+};
+
+struct MPU_REGION_CONFIG
+{
+	uint8_t 	regionNum; 		// where regions overlap, the higher region number wins
+	uint32_t 	baseAddress; 		// must be a multiple of sizeInBytes
+	uint32_t 	sizeInBytes; 		// power of two from 32 bytes to 2 GB
+	MPU_MEMORY_TYPE memoryType;
+	bool 		executeNever;
+	bool 		readOnly;
+	uint8_t 	subregionDisableMask; 	// each bit disables an eighth of the region, only for regions of 256 bytes or more
+};
+
+constexpr uint32_t fmc_sdram_bank_address (const FMC_SDRAM_BANK& bank)
+{
+	return ( bank == FMC_SDRAM_BANK::BANK_5 ) ? 0xC0000000 : 0xD0000000;
+}
+
+// sdram chip profile, timings are in nanoseconds from the datasheet and get converted to cycles for the actual sdclk
+struct FMC_SDRAM_CHIP_PROFILE
+{
+	FMC_SDRAM_COL_ADDR_BITS 	colBits;
+	FMC_SDRAM_ROW_ADDR_BITS 	rowBits;
+	FMC_SDRAM_DATA_ADDR_BITS 	dataBits;
+	FMC_SDRAM_NUM_BANKS 		numBanks;
+	uint32_t 			sizeInBytes;
+	uint32_t 			maxFreqCas2; 		// highest sdclk frequency with each cas latency, 0 if unsupported
+	uint32_t 			maxFreqCas3;
+	uint32_t 			tMRDInCycles; 		// load mode register to active
+	uint32_t 			tWRMinCycles; 		// some chips give write recovery as cycles plus nanoseconds
+	uint32_t 			tXSRInNs; 		// exit self-refresh to active
+	uint32_t 			tRASInNs; 		// active to precharge
+	uint32_t 			tRCInNs; 		// active to active
+	uint32_t 			tWRInNs; 		// write recovery
+	uint32_t 			tRPInNs; 		// precharge to active
+	uint32_t 			tRCDInNs; 		// active to read or write
+	uint32_t 			tREFInMilliseconds; 	// every row is refreshed in this time
+	uint32_t 			numRows;
+	uint32_t 			numAutoRefresh; 	// auto-refresh commands needed in the power up sequence
+};
+
+// issi IS42S32800J-6 (8M x 32)
+constexpr FMC_SDRAM_CHIP_PROFILE FMC_SDRAM_IS42S32800 = { FMC_SDRAM_COL_ADDR_BITS::BITS_9, FMC_SDRAM_ROW_ADDR_BITS::BITS_12,
+								FMC_SDRAM_DATA_ADDR_BITS::BITS_31, FMC_SDRAM_NUM_BANKS::BANKS_4,
+								32 * 1024 * 1024, 100000000, 166000000, 2, 2, 70, 42, 60, 12, 18, 18,
+								64, 4096, 8 };
+
+// micron MT48LC4M32B2-6A (4M x 32)
+constexpr FMC_SDRAM_CHIP_PROFILE FMC_SDRAM_MT48LC4M32 = { FMC_SDRAM_COL_ADDR_BITS::BITS_8, FMC_SDRAM_ROW_ADDR_BITS::BITS_12,
+								FMC_SDRAM_DATA_ADDR_BITS::BITS_31, FMC_SDRAM_NUM_BANKS::BANKS_4,
+								16 * 1024 * 1024, 100000000, 167000000, 2, 2, 70, 42, 60, 12, 18, 18,
+								64, 4096, 8 };
+
+// timings in cycles solved for an sdclk frequency
+struct FMC_SDRAM_TIMINGS
+{
+	FMC_SDRAM_CAS_LATENCY 	casLatency   = FMC_SDRAM_CAS_LATENCY::CYCLES_3;
+	uint32_t 		tMRD         = 0;
+	uint32_t 		tXSR         = 0;
+	uint32_t 		tRAS         = 0;
+	uint32_t 		tRC          = 0;
+	uint32_t 		tWR          = 0;
+	uint32_t 		tRP          = 0;
+	uint32_t 		tRCD         = 0;
+	uint32_t 		refreshCount = 0; 	// SDRTR COUNT value
+	uint16_t 		modeRegister = 0; 	// burst length 1, cas latency, single write burst
+	bool 			valid        = false;
+};
+
+constexpr uint32_t FMC_SDRAM_MAX_TIMING_CYCLES = 16;
+constexpr uint32_t FMC_SDRAM_MIN_REFRESH_COUNT = 41;
+constexpr uint32_t FMC_SDRAM_MAX_REFRESH_COUNT = 8191;
+
+constexpr uint32_t fmc_sdram_ns_to_cycles (const uint32_t ns, const uint32_t sdclkFreq, const uint32_t minCycles = 1)
+{
+	const uint32_t cycles = static_cast<uint32_t>( ((static_cast<uint64_t>(ns) * sdclkFreq) + 999999999) / 1000000000 );
+	return ( cycles < minCycles ) ? minCycles : cycles;
+}
+
+constexpr uint32_t fmc_sdram_max (const uint32_t a, const uint32_t b)
+{
+	return ( a > b ) ? a : b;
+}
+
+// the shortest legal timings, with the lowest cas latency the chip allows at the given sdclk frequency
+constexpr FMC_SDRAM_TIMINGS fmc_sdram_solve_timings (const FMC_SDRAM_CHIP_PROFILE& chip, const uint32_t sdclkFreq)
+{
+	FMC_SDRAM_TIMINGS timings;
+	if ( sdclkFreq == 0 || chip.numRows == 0 )
+	{
+		return timings;
+	}
+
+	const bool cas2 = sdclkFreq <= chip.maxFreqCas2;
+	timings.casLatency = cas2 ? FMC_SDRAM_CAS_LATENCY::CYCLES_2 : FMC_SDRAM_CAS_LATENCY::CYCLES_3;
+
+	timings.tMRD = chip.tMRDInCycles;
+	timings.tXSR = fmc_sdram_ns_to_cycles( chip.tXSRInNs, sdclkFreq );
+	timings.tRAS = fmc_sdram_ns_to_cycles( chip.tRASInNs, sdclkFreq );
+	timings.tRC = fmc_sdram_ns_to_cycles( chip.tRCInNs, sdclkFreq );
+	timings.tRP = fmc_sdram_ns_to_cycles( chip.tRPInNs, sdclkFreq );
+	timings.tRCD = fmc_sdram_ns_to_cycles( chip.tRCDInNs, sdclkFreq );
+
+	// the fmc also needs twr >= tras - trcd and twr >= trc - trcd - trp
+	timings.tWR = fmc_sdram_ns_to_cycles( chip.tWRInNs, sdclkFreq, chip.tWRMinCycles );
+	if ( timings.tRAS > timings.tRCD )
+	{
+		timings.tWR = fmc_sdram_max( timings.tWR, timings.tRAS - timings.tRCD );
+	}
+	if ( timings.tRC > timings.tRCD + timings.tRP )
+	{
+		timings.tWR = fmc_sdram_max( timings.tWR, timings.tRC - timings.tRCD - timings.tRP );
+	}
+
+	// refresh rate minus the 20 cycle safety margin from the reference manual
+	const uint64_t cyclesPerRow = ( static_cast<uint64_t>(chip.tREFInMilliseconds) * sdclkFreq ) / ( 1000 * chip.numRows );
+	timings.refreshCount = ( cyclesPerRow > 20 ) ? static_cast<uint32_t>( cyclesPerRow - 20 ) : 0;
+
+	timings.modeRegister = ( (cas2 ? 2 : 3) << 4 ) | ( 1 << 9 );
+
+	const uint32_t maxCycles = fmc_sdram_max( fmc_sdram_max(fmc_sdram_max(timings.tMRD, timings.tXSR),
+								fmc_sdram_max(timings.tRAS, timings.tRC)),
+							fmc_sdram_max(fmc_sdram_max(timings.tWR, timings.tRP), timings.tRCD) );
+
+	timings.valid = ( cas2 || sdclkFreq <= chip.maxFreqCas3 ) && maxCycles <= FMC_SDRAM_MAX_TIMING_CYCLES
+			&& timings.refreshCount >= FMC_SDRAM_MIN_REFRESH_COUNT && timings.refreshCount <= FMC_SDRAM_MAX_REFRESH_COUNT;
+
+	return timings;
+}
+
+static_assert( fmc_sdram_solve_timings(FMC_SDRAM_IS42S32800, 120000000).valid, "IS42S32800 should run at 120 MHz" );
+static_assert( fmc_sdram_solve_timings(FMC_SDRAM_MT48LC4M32, 120000000).valid, "MT48LC4M32 should run at 120 MHz" );
+
+// throughput floor for the uncached 64 bit accesses made by the sdram self-check. Each access is modeled as the data beats
+// plus a fixed bus overhead, with reads also paying the cas latency and read pipe delay unless burst read hides them, and only
+// half of the modeled rate is required so just a misconfigured clock, bus width or burst setting fails
+constexpr uint32_t FMC_SDRAM_ACCESS_OVERHEAD_CYCLES = 4;
+constexpr uint32_t FMC_SDRAM_SELF_CHECK_ACCESS_SIZE = 8;
+
+constexpr uint32_t fmc_sdram_bus_width_in_bytes (const FMC_SDRAM_DATA_ADDR_BITS& dataBits)
+{
+	return 1 << static_cast<uint32_t>( dataBits );
+}
+
+constexpr uint32_t fmc_sdram_min_write_MBps (const uint32_t sdclkFreq, const FMC_SDRAM_DATA_ADDR_BITS& dataBits)
+{
+	return static_cast<uint32_t>( (static_cast<uint64_t>(FMC_SDRAM_SELF_CHECK_ACCESS_SIZE) * sdclkFreq)
+					/ ((FMC_SDRAM_SELF_CHECK_ACCESS_SIZE / fmc_sdram_bus_width_in_bytes(dataBits))
+						+ FMC_SDRAM_ACCESS_OVERHEAD_CYCLES) / 1000000 / 2 );
+}
+
+constexpr uint32_t fmc_sdram_min_read_MBps (const uint32_t sdclkFreq, const FMC_SDRAM_DATA_ADDR_BITS& dataBits,
+						const FMC_SDRAM_CAS_LATENCY& casLatency, const bool burstRead,
+						const FMC_SDRAM_RPIPE_DELAY& rPipeDelay)
+{
+	return static_cast<uint32_t>( (static_cast<uint64_t>(FMC_SDRAM_SELF_CHECK_ACCESS_SIZE) * sdclkFreq)
+					/ ((FMC_SDRAM_SELF_CHECK_ACCESS_SIZE / fmc_sdram_bus_width_in_bytes(dataBits))
+						+ FMC_SDRAM_ACCESS_OVERHEAD_CYCLES
+						+ (burstRead ? 1 : static_cast<uint32_t>(casLatency) + static_cast<uint32_t>(rPipeDelay)))
+					/ 1000000 / 2 );
+}
+
+// the sdram banks are device memory in the default memory map, so they're uncached and can't hold code without a region
+constexpr MPU_REGION_CONFIG mpu_profile_sdram (const uint8_t regionNum, const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes)
+{
+	return { regionNum, fmc_sdram_bank_address(bank), sizeInBytes, MPU_MEMORY_TYPE::CACHEABLE_WRITE_BACK, false, false, 0 };
+}
+
+// write-through, so drawing reaches memory for the ltdc without cleaning while reads for blending still hit the cache,
+// usually placed over part of an sdram region
+constexpr MPU_REGION_CONFIG mpu_profile_framebuffer (const uint8_t regionNum, const uint32_t baseAddress, const uint32_t sizeInBytes)
+{
+	return { regionNum, baseAddress, sizeInBytes, MPU_MEMORY_TYPE::CACHEABLE_WRITE_THROUGH, true, false, 0 };
+}
+
+// uncached, so buffers shared with dma (or the other core) need no cache maintenance
+constexpr MPU_REGION_CONFIG mpu_profile_dma_buffer (const uint8_t regionNum, const uint32_t baseAddress, const uint32_t sizeInBytes)
+{
+	return { regionNum, baseAddress, sizeInBytes, MPU_MEMORY_TYPE::NON_CACHEABLE, true, false, 0 };
+}
+
+// shared sram layout. D3 sram (sram4) holds driver state and dma buffers that both cores and the bdma can reach, and the top of
+// d2 sram is kept out of the cortex-m4 linker scripts for structures shared between the cores. Slots are given offsets in table
+// order within their region, each starting on its own cache line so cache maintenance on one never touches another
+enum class SRAM_REGION
+{
+	D2_SHARED,
+	D3
+};
+
+enum class SRAM_SLOT
+{
+	TIM6_DELAY,
+	ADC_VALUES, 		// written by dma
+	ADC_CHANNEL_ORDER,
+	ADC_CHANNEL_RANK,
+	CORE_SYNC,
+	NUM_SLOTS
+};
+
+struct SRAM_SLOT_DESC
+{
+	SRAM_SLOT 	slot;
+	SRAM_REGION 	region;
+	const char* 	name;
+	uint32_t 	sizeInBytes;
+};
+
+constexpr uint32_t D2_SRAM_SIZE_IN_BYTES = 288 * 1024;
+constexpr uint32_t D2_SRAM_SHARED_SIZE_IN_BYTES = 1024; // needs to match the cortex-m4 linker scripts
+constexpr uint32_t D3_SRAM_SIZE_IN_BYTES = 64 * 1024;
+
+constexpr SRAM_SLOT_DESC SRAM_SLOT_DESCS[] =
+{
+	{ SRAM_SLOT::TIM6_DELAY, 	SRAM_REGION::D3, 	"tim6 delay", 		sizeof(float) * 3 + sizeof(uint32_t) },
+	{ SRAM_SLOT::ADC_VALUES, 	SRAM_REGION::D3, 	"adc values", 		sizeof(uint32_t) * 32 },
+	{ SRAM_SLOT::ADC_CHANNEL_ORDER, SRAM_REGION::D3, 	"adc channel order", 	sizeof(ADC_CHANNEL) * 32 },
+	{ SRAM_SLOT::ADC_CHANNEL_RANK, 	SRAM_REGION::D3, 	"adc channel rank", 	sizeof(uint8_t) * ADC_NUM_CHANNELS * 2 },
+	{ SRAM_SLOT::CORE_SYNC, 	SRAM_REGION::D2_SHARED, "core sync", 		sizeof(bool) },
+};
+
+constexpr unsigned int NUM_SRAM_SLOTS = static_cast<unsigned int>( SRAM_SLOT::NUM_SLOTS );
+
+constexpr bool sram_slot_descs_in_order (const unsigned int index = 0)
+{
+	return ( index == NUM_SRAM_SLOTS ) || ( static_cast<unsigned int>(SRAM_SLOT_DESCS[index].slot) == index
+							&& sram_slot_descs_in_order(index + 1) );
+}
+
+static_assert( sizeof(SRAM_SLOT_DESCS) / sizeof(SRAM_SLOT_DESC) == NUM_SRAM_SLOTS, "Every sram slot needs a descriptor" );
+static_assert( sram_slot_descs_in_order(), "Sram slot descriptors must be in the same order as the SRAM_SLOT enum" );
+
+constexpr uint32_t sram_region_base (const SRAM_REGION& region)
+{
+	return ( region == SRAM_REGION::D3 ) ? D3_SRAM_BASE : D2_AHBSRAM_BASE + D2_SRAM_SIZE_IN_BYTES - D2_SRAM_SHARED_SIZE_IN_BYTES;
+}
+
+constexpr uint32_t sram_region_size (const SRAM_REGION& region)
+{
+	return ( region == SRAM_REGION::D3 ) ? D3_SRAM_SIZE_IN_BYTES : D2_SRAM_SHARED_SIZE_IN_BYTES;
+}
+
+constexpr uint32_t sram_slot_padded_size (const unsigned int index)
+{
+	return ( (SRAM_SLOT_DESCS[index].sizeInBytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE ) * CACHE_LINE_SIZE;
+}
+
+// bytes taken by the slots in a region before the given slot index
+constexpr uint32_t sram_region_used_bytes (const SRAM_REGION& region, const unsigned int endIndex = NUM_SRAM_SLOTS)
+{
+	return ( endIndex == 0 ) ? 0 : sram_region_used_bytes( region, endIndex - 1 )
+					+ ( (SRAM_SLOT_DESCS[endIndex - 1].region == region) ? sram_slot_padded_size(endIndex - 1) : 0 );
+}
+
+constexpr const SRAM_SLOT_DESC& sram_slot_desc (const SRAM_SLOT& slot)
+{
+	return SRAM_SLOT_DESCS[static_cast<unsigned int>( slot )];
+}
+
+constexpr uint32_t sram_slot_offset (const SRAM_SLOT& slot)
+{
+	return sram_region_used_bytes( sram_slot_desc(slot).region, static_cast<unsigned int>(slot) );
+}
+
+constexpr uint32_t sram_slot_address (const SRAM_SLOT& slot)
+{
+	return sram_region_base( sram_slot_desc(slot).region ) + sram_slot_offset( slot );
+}
+
+static_assert( sram_region_used_bytes(SRAM_REGION::D2_SHARED) <= D2_SRAM_SHARED_SIZE_IN_BYTES, "D2 shared sram slots don't fit" );
+static_assert( sram_region_used_bytes(SRAM_REGION::D3) <= D3_SRAM_SIZE_IN_BYTES, "D3 sram slots don't fit" );
+
+// the rest of d3 sram is free for the application, starting on a cache line (and uncached up to the end of the slots' mpu region)
+constexpr unsigned int D3_SRAM_UNUSED_OFFSET_IN_BYTES = sram_region_used_bytes( SRAM_REGION::D3 );
+
+// the slots are shared with cpu2, which has no cache, so the cortex-m7 keeps them out of its d-cache with an mpu region per sram
+// region. They use the highest region numbers, so they win over any application region that overlaps them
+constexpr uint8_t MPU_REGION_D2_SHARED_SLOTS = 14;
+constexpr uint8_t MPU_REGION_D3_SLOTS = 15;
+
+// smallest mpu region size holding numBytes
+constexpr uint32_t mpu_region_size_for (const uint32_t numBytes, const uint32_t sizeInBytes = 32)
+{
+	return ( sizeInBytes >= numBytes ) ? sizeInBytes : mpu_region_size_for( numBytes, sizeInBytes * 2 );
+}
+
+constexpr uint32_t sram_region_mpu_size (const SRAM_REGION& region)
+{
+	return mpu_region_size_for( sram_region_used_bytes(region) );
+}
+
+constexpr bool sram_region_fits_mpu_region (const SRAM_REGION& region)
+{
+	return sram_region_used_bytes( region ) <= sram_region_mpu_size( region )
+		&& sram_region_mpu_size( region ) <= sram_region_size( region )
+		&& ( sram_region_base(region) % sram_region_mpu_size(region) ) == 0;
+}
+
+static_assert( sram_region_fits_mpu_region(SRAM_REGION::D2_SHARED), "D2 shared sram slots don't fit an aligned mpu region" );
+static_assert( sram_region_fits_mpu_region(SRAM_REGION::D3), "D3 sram slots don't fit an aligned mpu region" );
+
+// sdram arena alignments, framebuffers aligned to the ltdc/dma2d burst size never split a burst
+constexpr uint32_t SDRAM_ARENA_MIN_ALIGNMENT = 4;
+constexpr uint32_t LTDC_BURST_SIZE_IN_BYTES = 64;
+
+// fixed size blocks carved from the sdram arena, free blocks hold the pointer to the next free block
+struct SDRAM_POOL
+{
+	uint8_t* 	firstBlock = nullptr;
+	uint8_t* 	freeList   = nullptr;
+	uint32_t 	blockSize  = 0; 	// rounded up to the alignment, so every block is aligned
+	uint32_t 	numBlocks  = 0;
+	uint32_t 	numFree    = 0;
+};
+
+// memory benchmark results, bandwidths use the core clock of the core running the benchmark
+struct MEM_BENCH_RESULT
+{
+	uint32_t readMBps           = 0; 	// sequential 32 bit reads
+	uint32_t writeMBps          = 0; 	// sequential 32 bit writes
+	uint32_t copyMBps           = 0; 	// first half of the buffer to the second half, in bytes copied
+	float    stridedReadCycles  = 0.0f; 	// per 32 bit read, two cache lines apart
+	float    randomLoadCycles   = 0.0f; 	// per dependent load, chasing a random cycle through the buffer's cache lines
+};
+
+// bandwidth in MB/s for numBytes moved in the given number of cycles of a core running at coreFreq
+constexpr uint32_t mem_bandwidth_MBps (const uint64_t numBytes, const uint32_t cycles, const uint32_t coreFreq)
+{
+	return ( cycles == 0 ) ? 0 : static_cast<uint32_t>( (numBytes * coreFreq) / cycles / 1000000 );
+}
+
+// gpio benchmark results, in core cycles per write of the pin
+constexpr uint32_t GPIO_BENCH_NUM_WRITES = 1024;
+constexpr uint32_t GPIO_BENCH_WRITES_PER_LOOP = 8; // spreads the loop overhead over several writes
+
+struct GPIO_BENCH_RESULT
+{
+	float switchOutputSetCycles = 0.0f; 	// the switch based gpio_output_set that the computed port address and pin mask replaced
+	float outputSetCycles       = 0.0f; 	// gpio_output_set, called from another translation unit
+	float pinWriteCycles        = 0.0f; 	// Pin<>::write, inlined
+};
+
+// sdram self-check stages, in the order they run
+enum class SDRAM_TEST_STAGE
+{
+	NONE, 		// everything passed
+	DATA_BUS, 	// walking ones on the first word
+	ADDRESS_BUS, 	// a pattern at every power of 2 offset
+	MARCH, 		// march c- over every 64 bit word
+	THROUGHPUT 	// read or write throughput below the floor for the fmc configuration
+};
+
+struct SDRAM_TEST_RESULT
+{
+	SDRAM_TEST_STAGE failedStage  = SDRAM_TEST_STAGE::NONE;
+	uint32_t         failAddress  = 0;
+	uint32_t         expected     = 0;
+	uint32_t         actual       = 0;
+	uint32_t         readMBps     = 0;
+	uint32_t         writeMBps    = 0;
+	uint32_t         minReadMBps  = 0;
+	uint32_t         minWriteMBps = 0;
+};
 
 class LLPD
 {
@@ -362,6 +1413,74 @@ class LLPD
 		static void rcc_clock_start_max_cpu2(); // starts M4 core at 240 MHx using PLL and LDO (needs to be used with above function)
 		static void rcc_start_pll2 (const unsigned int pllMultiply = 150); // the output of pll2 divr2 will be pllMultiply * 1 MHz
 		static void rcc_start_pll3 (const unsigned int pllMultiply = 150); // the output of pll3 divr3 will be pllMultiply * 1 MHz / 5
+		// the below use settings from the clock solver (see RccClockSolution and RccPllSolution), pll2 and pll3 assume a 16 MHz hse
+		static void rcc_clock_start_cpu1 (const RCC_CLOCK_CONFIG& config); // same as rcc_clock_start_max_cpu1, with any clock settings
+		static void rcc_start_pll2 (const RCC_PLL_CONFIG& config);
+		static void rcc_start_pll3 (const RCC_PLL_CONFIG& config);
+		// dynamic voltage and frequency scaling for cpu1 after rcc_clock_start_cpu1, the voltage scaling and flash latency follow the
+		// new frequencies, returns the switch latency in nanoseconds (or 0 if the config is invalid). Peripheral dividers set up
+		// from the old bus clocks aren't updated
+		static uint32_t rcc_clock_change_cpu1 (const RCC_CLOCK_CONFIG& config);
+		// the below read the current clock tree from the rcc registers, returning 0 for disabled or unknown clocks
+		static void rcc_set_hse_freq (const uint32_t hseFreq); // defaults to 16 MHz, set automatically by rcc_clock_start_cpu1
+		static uint32_t rcc_get_clock_freq (const RCC_CLOCK& clock);
+		static uint32_t rcc_get_usart_kernel_freq (const USART_NUM& usartNum);
+		static uint32_t rcc_get_spi_kernel_freq (const SPI_NUM& spiNum);
+		static uint32_t rcc_get_sdmmc_kernel_freq();
+		static uint32_t rcc_get_fmc_kernel_freq();
+		static uint32_t rcc_get_core_freq(); // cpu1 on the cortex-m7, ahb on the cortex-m4
+
+		// Power
+		// lptim1 (on per_ck, which is kept running in stop) is used as the wakeup timer for up to 131 ms with the default 64 MHz per_ck,
+		// exti lines set up with gpio_interrupt_setup and any enabled interrupt also wake the core
+		static void pwr_wakeup_timer_setup();
+		static void pwr_enter_low_power_mode (const PWR_LOW_POWER_MODE& mode, const uint32_t wakeupMicroseconds = 0); // 0 = no timer
+		static uint32_t pwr_get_wake_latency_cycles(); // cycles from the last wakeup timer event until pwr_enter_low_power_mode
+								// returned, or 0 if something else woke the core
+
+		// Peripheral clocks
+		// the rcc enable registers are per core, so a peripheral is clocked while either core has it enabled
+		static void periph_enable_clock (const PERIPH& periph); 	// also marks the peripheral as used by this core
+		static void periph_disable_clock (const PERIPH& periph);
+		static void periph_reset (const PERIPH& periph);
+		static bool periph_clock_is_enabled (const PERIPH& periph);
+		static void periph_power_down_unused(); // gates the clocks (including in csleep) of every peripheral this core didn't enable
+
+		// Cache (cortex-m7 only, the functions do nothing on the cortex-m4)
+		// the d-cache is write-back, so buffers the cpu writes need cleaning before dma reads them, and buffers dma writes need
+		// invalidating before the cpu reads them. The llpd dma drivers do this themselves
+		static void cache_enable(); // i-cache and d-cache with the sram slots uncached, called by rcc_clock_start_cpu1
+		static bool cache_dcache_is_enabled();
+		static bool cache_range_is_aligned (const void* address, uint32_t numBytes); // true if on whole CACHE_LINE_SIZE lines
+		static void cache_clean_range (const void* address, uint32_t numBytes);
+		// returns false if the range isn't on whole cache lines, in which case the partial lines at the ends are written back instead
+		// of being discarded, which is only safe if the cpu doesn't write next to the buffer while dma is writing to it
+		static bool cache_invalidate_range (void* address, uint32_t numBytes);
+		static void cache_clean_invalidate_range (void* address, uint32_t numBytes);
+
+		// MPU
+		// regions can be set up while the mpu is enabled, the default memory map applies outside of them
+		static bool mpu_configure_region (const MPU_REGION_CONFIG& config); // returns false if the region is invalid
+		static void mpu_disable_region (const uint8_t regionNum);
+		static unsigned int mpu_get_num_regions(); // 16 on the cortex-m7, 8 on the cortex-m4
+		static void mpu_enable();
+		static void mpu_disable();
+
+		// Memory benchmark (dwt cycle counter on the calling core with interrupts masked, the buffer's contents are overwritten)
+		// the buffer needs to be at least 256 bytes in the memory being measured, and larger than the 16 KB d-cache to measure the
+		// memory rather than the cache. Itcm and dtcm are only reachable from cpu1, which is also the only core with caches
+		static MEM_BENCH_RESULT mem_bench_run (void* buffer, const uint32_t sizeInBytes); // with the caches as they are
+		static void mem_bench_log (const USART_NUM& usartNum, const char* regionName, void* buffer,
+						const uint32_t sizeInBytes); // runs with the d-cache on and off on cpu1
+
+		// GPIO benchmark (dwt cycle counter on the calling core with interrupts masked, the pin needs to be set up as an output
+		// and toggles for the whole run). Pin<> needs the pin at compile time, so pass &gpio_bench_pin_write_cycles<port, pin>
+		static GPIO_BENCH_RESULT gpio_bench_run (const GPIO_PORT& port, const GPIO_PIN& pin,
+						uint32_t (*pinWriteCycles)(uint32_t numLoops));
+		static void gpio_bench_log (const USART_NUM& usartNum, const GPIO_BENCH_RESULT& result);
+
+		// SRAM layout
+		static void sram_layout_log (const USART_NUM& usartNum); // logs the address and size of every shared sram slot
 
 		// GPIO
 		static void gpio_enable_clock (const GPIO_PORT& port);
@@ -373,30 +1492,103 @@ class LLPD
 						bool alternateFunc = false, const int afValue = 0);
 		static bool gpio_input_get (const GPIO_PORT& port, const GPIO_PIN& pin);
 		static void gpio_output_set (const GPIO_PORT& port, const GPIO_PIN& pin, bool set);
+		// port-wide access, each of these is a single BSRR write or IDR read so all pins change/are sampled together
+		// (masks use one bit per pin, for example gpio_pin_mask(GPIO_PIN::PIN_3) | gpio_pin_mask(GPIO_PIN::PIN_4))
+		static uint16_t gpio_port_input_get (const GPIO_PORT& port);
+		static void gpio_port_output_set_mask (const GPIO_PORT& port, uint16_t setMask);
+		static void gpio_port_output_clear_mask (const GPIO_PORT& port, uint16_t clearMask);
+		static void gpio_port_output_write_mask (const GPIO_PORT& port, uint16_t setMask, uint16_t clearMask); // set wins on overlap
+		static void gpio_port_output_write_range (const GPIO_PORT& port, const GPIO_PIN& firstPin, unsigned int numBits,
+								uint16_t value); // writes value to pins firstPin to firstPin + numBits - 1
 		static void gpio_test();
+		static void gpio_apply_port_image (const GPIO_PORT& port, const GPIO_PORT_IMAGE& image); // usually called through PinMap
+
+		// GPIO EXTI (each pin number has one exti line shared by all ports, so only one port can use a pin number at a time)
+		// the callback is called from the exti isr with the pending flag already cleared
+		static void gpio_interrupt_setup (const GPIO_PORT& port, const GPIO_PIN& pin, const GPIO_EXTI_EDGE& edge,
+							void (*callback)(), uint8_t priority = 0x02);
+		static void gpio_interrupt_enable (const GPIO_PIN& pin);
+		static void gpio_interrupt_disable (const GPIO_PIN& pin);
+
+		// GPIO debouncing (pins need to be set up as inputs first)
+		// to use debouncing, gpio_debounce_isr_sample needs to be called from a timer isr (tim6 for example). Each tick reads each
+		// port once and a pin change is only reported after it has been stable for 4 ticks, so a 1 kHz tick gives 4 ms debouncing
+		static void gpio_debounce_add_pin (const GPIO_PORT& port, const GPIO_PIN& pin, bool activeLow = true);
+		static void gpio_debounce_isr_sample();
+		static bool gpio_debounce_get_event (GPIO_DEBOUNCE_EVENT& event); // returns false if there are no events, main loop only
+		static bool gpio_debounce_is_pressed (const GPIO_PORT& port, const GPIO_PIN& pin);
+		static unsigned int gpio_debounce_get_num_dropped_events(); // events are dropped if the queue fills before being read
+
+		// GPIO waveform engine (tim7 paces dma2 stream 0, which writes one word from the buffer into the port's BSRR per update)
+		// the word rate is the tim7 kernel clock / ( prescalerDivisor + 1 ) / cyclesPerWord, where cyclesPerWord must be at least 1,
+		// buffers can't use DTCM memory
+		// the encode functions return the number of words written, which the buffer must have room for
+		static void gpio_waveform_init (const GPIO_PORT& port, uint32_t prescalerDivisor, uint32_t cyclesPerWord);
+		static void gpio_waveform_start (const uint32_t* bsrrWords, uint16_t numWords, bool circular = false);
+		static void gpio_waveform_stop();
+		static bool gpio_waveform_is_busy();
+		static unsigned int gpio_waveform_encode_serial (const GPIO_PIN& dataPin, const uint8_t* bytes, unsigned int numBytes,
+									uint32_t* bsrrWords); // msb first, 8 words per byte
+		static unsigned int gpio_waveform_encode_serial_clocked (const GPIO_PIN& dataPin, const GPIO_PIN& clockPin,
+										const uint8_t* bytes, unsigned int numBytes,
+										uint32_t* bsrrWords); // msb first, 16 words per byte
+		static unsigned int gpio_waveform_encode_parallel (const GPIO_PIN& firstPin, const uint8_t* bytes, unsigned int numBytes,
+									uint32_t* bsrrWords); // 8 contiguous pins, 1 word per byte
 
 		// ADC
 		// initialization needs to take place after counter is started for tim6, since it uses delay function
 		// adc12 uses adc1 channels
-		// adc values and order are stored on D3 sram, so if you plan on using that account for the sizeof(uint32_t) * 32
-		// plus sizeof(ADC_CHANNEL) * 32 bytes it takes up (offset value found above)
-		// TODO we really need to specify cyclesPerSample separately for fast and slow channels...
+		// adc values, order and ranks are stored in d3 sram slots, so if you plan on using d3 sram start at D3_SRAM_UNUSED_OFFSET_IN_BYTES
+		// adc_init sets cyclesPerSample for every channel, the array version of adc_set_channel_order can then give each channel
+		// in the sequence its own sample time (cyclesPerSample[n] is for channelsInOrder[n], nullptr keeps the current ones)
 		static void adc_init (const ADC_NUM& adcNum, const ADC_CYCLES_PER_SAMPLE& cyclesPerSample);
 		static void adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, const ADC_CHANNEL& channel...);
+		static void adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, const ADC_CHANNEL* channelsInOrder,
+							const ADC_CYCLES_PER_SAMPLE* cyclesPerSample = nullptr);
+		static float adc_get_sequence_cycles (const ADC_NUM& adcNum); // sampling and conversion adc clock cycles for the sequence
+		// resolution and oversampling apply to the whole sequence and stop any running conversion, adc_init sets 12 bits and
+		// no oversampling. Oversampling accumulates ratio conversions (1 to 1024, 1 disables it) and shifts the sum right by
+		// rightShift (up to 11), so the results can be wider than 16 bits and should then be read through adc_get_frame.
+		// Returns false if the ratio or shift is out of range
+		static void adc_set_resolution (const ADC_NUM& adcNum, const ADC_RESOLUTION& resolution);
+		static bool adc_set_oversampling (const ADC_NUM& adcNum, unsigned int ratio, uint8_t rightShift,
+							const ADC_OVERSAMPLING_MODE& mode = ADC_OVERSAMPLING_MODE::CONTINUED);
 		static void adc_perform_conversion_sequence (const ADC_NUM& adcNum);
 		static uint16_t adc_get_channel_value (const ADC_NUM& adcNum, const ADC_CHANNEL& adcChannel);
+		static uint8_t adc_get_channel_rank (const ADC_NUM& adcNum, const ADC_CHANNEL& adcChannel); // index into any frame
+		static const uint32_t* adc_get_frame (const ADC_NUM& adcNum); // the last values in sequence order, one per channel
+		static uint8_t adc_get_num_channels_in_sequence (const ADC_NUM& adcNum);
+		// continuous mode, the adc converts the sequence back to back and the dma writes it into buffer in circular mode. The
+		// buffer holds 2 * numFramesPerHalf frames of one uint32_t per channel in sequence order, halfCallback is called from
+		// the dma isr with the first half once it's filled and fullCallback with the second half, each needs to finish before
+		// the dma wraps around to its half. With the d-cache on each half needs to be on whole cache lines, the adc3 buffer
+		// needs to be in d3 sram and neither can be in DTCM memory. Returns false if the buffer can't be used.
+		// adc_perform_conversion_sequence can't be used until adc_stop_continuous is called
+		static bool adc_start_continuous (const ADC_NUM& adcNum, uint32_t* buffer, unsigned int numFramesPerHalf,
+							void (*halfCallback)(const uint32_t* frames, unsigned int numFrames),
+							void (*fullCallback)(const uint32_t* frames, unsigned int numFrames),
+							uint8_t priority = 0x02);
+		static void adc_stop_continuous (const ADC_NUM& adcNum);
+		// external trigger for the regular sequence, with a trigger set each trigger edge converts the whole sequence once.
+		// adc_perform_conversion_sequence then waits for the next trigger, and continuous mode writes one frame per trigger
+		// instead of converting back to back. EXTI_11 needs exti line 11 set up with gpio_interrupt_setup
+		static void adc_set_trigger (const ADC_NUM& adcNum, const ADC_TRIGGER& trigger, const ADC_TRIGGER_EDGE& edge);
 
 		// DAC dac1( vout1 = a4, vout2 = a5 )
 		static void dac_init (bool useVoltageBuffer); // not using dma
 		static void dac_init_use_dma (bool useVoltageBuffer, uint32_t* buffer1, uint32_t* buffer2, unsigned int numSamplesPerBuf); // can't use DTCM memory for buffers
 		static void dac_send (uint16_t ch1Data, uint16_t ch2Data); // only for use if not using DMA
+		static void dac_dma_buffer_filled (const uint32_t* buffer); // call after writing a buffer, so the dma sees it with the d-cache on
 		static bool dac_dma_using_buffer1();
 		static void dac_dma_stop();
 
 		// TIM6
-		// tim6 stores 3 internal variables for delay functions across cores in D3 sram, so if you plan on using that account
-		// for the sizeof(float) * 3 bytes it takes up (offset value found above)
-		static void tim6_counter_setup (uint32_t prescalerDivisor, uint32_t cyclesPerInterrupt, uint32_t interruptRate);
+		// tim6 stores its delay function state for both cores in the SRAM_SLOT::TIM6_DELAY d3 sram slot, so if you plan on using
+		// d3 sram start at D3_SRAM_UNUSED_OFFSET_IN_BYTES (sram_layout_log shows where every slot is)
+		// the interrupt rate needs to be between 1 and half the apb1 timer clock and cyclesPerInterrupt at least 1, otherwise
+		// the setup does nothing
+		static void tim6_counter_setup (uint32_t interruptRate); // picks the prescaler and auto-reload values from the timer clock
+		static void tim6_counter_setup (uint32_t prescalerDivisor, uint32_t cyclesPerInterrupt); // register values (divider - 1)
 		static void tim6_counter_enable_interrupts();
 		static void tim6_counter_disable_interrupts();
 		static void tim6_counter_start();
@@ -407,6 +1599,13 @@ class LLPD
 							// It will return true if a delay is not finished, or false if it is.
 		static float tim6_get_usecond_incr(); // returns how many microseconds pass per interrupt
 
+		// TIM15
+		// tim15 only drives its trgo on every update, as a sample clock for ADC_TRIGGER::TIM15_TRGO that leaves tim6 to the
+		// delay functions. The setup picks the prescaler and auto-reload values and returns the exact rate it could get
+		static uint32_t tim15_trigger_setup (uint32_t triggerRate);
+		static void tim15_trigger_start();
+		static void tim15_trigger_stop();
+
 		// SPI spi1( sck =  a5, miso =  a6, mosi =  a7 )
 		//     spi2( sck = b13, miso = b14, mosi = b15 )
 		//     spi3( sck = c10, miso = c11, mosi = c12 )
@@ -418,6 +1617,7 @@ class LLPD
 						const SPI_CLK_PHASE& phase, const SPI_DUPLEX& duplex,
 						const SPI_FRAME_FORMAT& frameFormat, const SPI_DATA_SIZE& dataSize);
 		static void spi_master_change_baud_rate (const SPI_NUM& spiNum, const SPI_BAUD_RATE& baudRate);
+		static SPI_BAUD_RATE spi_get_baud_rate (const SPI_NUM& spiNum, const uint32_t maxBaudRate); // fastest divider not above maxBaudRate
 		static uint16_t spi_master_send_and_recieve (const SPI_NUM& spiNum, uint8_t data);
 
 		// I2C i2c1( sda = b7,  scl = b6  )
@@ -436,13 +1636,13 @@ class LLPD
 		//       usart3( tx = c10, rx = c11 )
 		//       usart6( tx = g14, rx = g9  )
 		static void usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordLen, const USART_PARITY& parity,
-					const USART_CONF& conf, const USART_STOP_BITS& stopBits, const unsigned int periphClockFreq,
-					const unsigned int baudRate);
+					const USART_CONF& conf, const USART_STOP_BITS& stopBits, const unsigned int baudRate);
 		static void usart_transmit (const USART_NUM& usartNum, uint16_t data);
 		static uint16_t usart_receive (const USART_NUM& usartNum);
 		static void usart_log (const USART_NUM& usartNum, const char* cStr); // needs to be proper c string with terminator
 		static void usart_log_int (const USART_NUM& usartNum, const char* cStr, int val);
 		static void usart_log_float (const USART_NUM& usartNum, const char* cStr, float val);
+		static void usart_log_hex (const USART_NUM& usartNum, const char* cStr, uint32_t val); // 0x prefixed, 8 uppercase digits
 
 		// Op Amp opamp1( v+ = b0, v- = c5, vout = c4 )
 		//        opamp2( v+ = e9, v- = e8, vout = e7 )
@@ -455,10 +1655,48 @@ class LLPD
 						const FMC_SDRAM_CAS_LATENCY& casLatency, const bool burstRead,
 						const FMC_SDRAM_RPIPE_DELAY& rPipeDelay, const bool writeProtection,
 						const uint8_t tMRD, const uint8_t tXSR, const uint8_t tRAS, const uint8_t tRC,
-						const uint8_t tWR, const uint8_t tRP, const uint8_t tRCD); // timing values are given in cycles
+						const uint8_t tWR, const uint8_t tRP, const uint8_t tRCD); // timings are register values (cycles - 1)
 		static void fmc_sdram_start (const bool startBank1, const bool startBank2, const uint8_t numAutoRefresh,
 						const unsigned int tREFInMilliseconds, const unsigned int numRows,
 						const unsigned int clkRateInMHz, const uint16_t modeRegisterValue);
+		// the same from a chip profile, with the timings solved for the sdclk from the fmc kernel clock. Sdclk, burst read, read
+		// pipe delay, trc and trp are shared by both banks, so both banks should use the same chip and settings. Returns false if
+		// the chip can't run at the sdclk frequency
+		static bool fmc_sdram_init (const FMC_SDRAM_BANK& bank, const FMC_SDRAM_CHIP_PROFILE& chip,
+						const FMC_SDRAM_CLOCK_CONFIG& clkConfig, const bool burstRead,
+						const FMC_SDRAM_RPIPE_DELAY& rPipeDelay);
+		static void fmc_sdram_start (const bool startBank1, const bool startBank2, const FMC_SDRAM_CHIP_PROFILE& chip);
+		static uint32_t fmc_sdram_get_clock_freq(); // sdclk, 0 if disabled
+		// low power modes for idle periods, the sdram can't be accessed until it's back in normal mode. Entering is refused
+		// (returns false) while an enabled dma stream, mdma channel, dma2d, sdmmc idma or ltdc layer points into a selected bank,
+		// and false is also returned if the mode doesn't take effect. The other core must stay out of the sdram on its own.
+		// Self-refresh should be entered before stopping the d1 domain
+		static bool fmc_sdram_enter_low_power (const bool bank1, const bool bank2, const FMC_SDRAM_POWER_MODE& mode);
+		static bool fmc_sdram_exit_low_power (const bool bank1, const bool bank2);
+		static FMC_SDRAM_POWER_MODE fmc_sdram_get_power_mode (const FMC_SDRAM_BANK& bank);
+		static bool fmc_sdram_dma_is_active (const bool bank1, const bool bank2);
+		static uint32_t fmc_sdram_get_last_transition_cycles(); // cpu cycles from the mode command to the status change
+
+		// SDRAM self-check (overwrites the whole range, so it runs before anything is allocated from the sdram)
+		// the data bus, address lines and every word are tested, then the throughput is measured with the d-cache off and
+		// compared against fmc_sdram_min_read_MBps/fmc_sdram_min_write_MBps for the fmc configuration. Sdram_test_log logs the
+		// result and with haltOnFailure never returns from a failure, repeating the failure on the usart instead
+		static SDRAM_TEST_RESULT sdram_test_run (const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes);
+		static bool sdram_test_log (const USART_NUM& usartNum, const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes,
+						const bool haltOnFailure = true);
+
+		// SDRAM arena (O(1) allocation from the started sdram, alignments need to be powers of 2)
+		// persistent allocations and pools come first, then the mark from sdram_arena_get_mark can be used to reset per frame
+		// allocations. Pools need to be created before the mark, since resetting past a pool frees its memory
+		static void sdram_arena_init (const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes);
+		static void* sdram_arena_alloc (const uint32_t numBytes, const uint32_t alignment = SDRAM_ARENA_MIN_ALIGNMENT); // nullptr if full
+		static uint32_t sdram_arena_get_mark();
+		static void sdram_arena_reset (const uint32_t mark = 0); // frees everything allocated after the mark
+		static uint32_t sdram_arena_get_free_bytes();
+		static bool sdram_pool_init (SDRAM_POOL& pool, const uint32_t blockSize, const uint32_t numBlocks,
+						const uint32_t alignment = CACHE_LINE_SIZE); // returns false if the arena is full
+		static void* sdram_pool_alloc (SDRAM_POOL& pool); // nullptr if every block is taken
+		static void sdram_pool_free (SDRAM_POOL& pool, void* block);
 
 		// LTDC
 		static void ltdc_init (const unsigned int hSyncWidth, const unsigned int hBackPorch, const unsigned int hFrontPorch,
@@ -478,10 +1716,11 @@ class LLPD
 
 		// SDMMC (SDMMC1, d0 = c8, d1 = c9, d2 = c10, d3 = c11, clk = c12, cmd = d2)
 		// not currently supporting cards over 2TB, secured cards, 1.8V signals, or any block size aside from 512
-		static bool sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDetectPin, const unsigned int pll2rClkRate,
+		static bool sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDetectPin,
 					const unsigned int targetSDMMCClkRate, const SDMMC_BUS_WIDTH& busWidth, const bool hardwareFlowCtrl,
-					const bool powerSave, const SDMMC_CLK_EDGE& clkEdge ); // returns false if failed
+					const bool powerSave, const SDMMC_CLK_EDGE& clkEdge ); // returns false if failed, start pll2 first
 		static bool sdmmc_erase (uint32_t address, uint32_t numBlocks);
+		// with the d-cache on, read buffers must be cache line aligned (the read fails otherwise)
 		static bool sdmmc_read_dma (uint32_t address, uint8_t* data, uint32_t numBlocks); // always using 512 blocks, address should be block
 		static bool sdmmc_write_dma (uint32_t address, uint8_t* data, uint32_t numBlocks); // always using 512 blocks, address should be block
 		static bool sdmmc_has_transfer_error(); // should be called after transfers to check for errors
@@ -494,4 +1733,189 @@ class LLPD
 		static inline void setup_alt_func_pin (GPIO_TypeDef* gpioPtr, int pinNum, const int afValue);
 };
 
+// compile-time clock solutions, the build fails if the requested frequencies can't be reached within maxErrorHz, for example:
+// 	using Clocks = RccClockSolution<16000000, 480000000, 240000000, 120000000>;
+// 	LLPD::rcc_clock_start_cpu1( Clocks::config );
+// 	using AudioPll = RccPllSolution<RCC_PLL_NUM::PLL_3, 16000000, 0, 0, 24576000>; // pll3 r at 512 * 48 kHz
+// 	LLPD::rcc_start_pll3( AudioPll::config );
+template <uint32_t hseFreq, uint32_t sysFreq, uint32_t ahbFreq, uint32_t apbFreq, uint32_t pll1qFreq = 0, uint32_t pll1rFreq = 0,
+		uint32_t maxErrorHz = 0>
+struct RccClockSolution
+{
+	static constexpr RCC_CLOCK_CONFIG config = rcc_solve_clocks( hseFreq, sysFreq, ahbFreq, apbFreq, pll1qFreq, pll1rFreq, maxErrorHz );
+
+	static_assert( config.pll1.valid, "No pll1 settings reach the requested frequencies within the allowed error" );
+	static_assert( config.hpre != 0xFFFFFFFF, "The ahb frequency must be sys_ck divided by 1, 2, 4, 8, 16, 64, 128, 256 or 512" );
+	static_assert( config.ppre != 0xFFFFFFFF, "The apb frequency must be the ahb frequency divided by 1, 2, 4, 8 or 16" );
+	static_assert( sysFreq <= RCC_MAX_SYS_FREQ && ahbFreq <= RCC_MAX_AHB_FREQ && apbFreq <= RCC_MAX_APB_FREQ,
+			"Requested frequencies exceed the maximum bus frequencies" );
+};
+
+template <uint32_t hseFreq, uint32_t sysFreq, uint32_t ahbFreq, uint32_t apbFreq, uint32_t pll1qFreq, uint32_t pll1rFreq, uint32_t maxErrorHz>
+constexpr RCC_CLOCK_CONFIG RccClockSolution<hseFreq, sysFreq, ahbFreq, apbFreq, pll1qFreq, pll1rFreq, maxErrorHz>::config;
+
+template <RCC_PLL_NUM pllNum, uint32_t srcFreq, uint32_t pFreq, uint32_t qFreq = 0, uint32_t rFreq = 0, uint32_t maxErrorHz = 0>
+struct RccPllSolution
+{
+	static constexpr RCC_PLL_CONFIG config = rcc_solve_pll( pllNum, srcFreq, pFreq, qFreq, rFreq, maxErrorHz );
+
+	static_assert( config.valid, "No pll settings reach the requested frequencies within the allowed error" );
+};
+
+template <RCC_PLL_NUM pllNum, uint32_t srcFreq, uint32_t pFreq, uint32_t qFreq, uint32_t rFreq, uint32_t maxErrorHz>
+constexpr RCC_PLL_CONFIG RccPllSolution<pllNum, srcFreq, pFreq, qFreq, rFreq, maxErrorHz>::config;
+
+// compile-time gpio pin, set/clear/write compile down to a single BSRR store and read to a single IDR load
+// (the pin still needs to be configured with gpio_output_setup or gpio_digital_input_setup first)
+template <GPIO_PORT port, GPIO_PIN pin>
+class Pin
+{
+	public:
+		static constexpr uint32_t portAddress = gpio_port_address( port );
+		static constexpr uint32_t mask = gpio_pin_mask( pin );
+
+		static inline void set()
+		{
+			portPtr()->BSRR = mask;
+		}
+
+		static inline void clear()
+		{
+			portPtr()->BSRR = mask << 16; // reset bits are in the upper half of BSRR
+		}
+
+		static inline void write (bool set)
+		{
+			portPtr()->BSRR = ( set ) ? mask : ( mask << 16 );
+		}
+
+		static inline void toggle()
+		{
+			// one ODR load and one BSRR store, so other pins on the port are never disturbed
+			const uint32_t odr = portPtr()->ODR;
+			portPtr()->BSRR = ( (odr & mask) << 16 ) | ( ~odr & mask );
+		}
+
+		static inline bool read()
+		{
+			return portPtr()->IDR & mask;
+		}
+
+	private:
+		static inline GPIO_TypeDef* portPtr()
+		{
+			return reinterpret_cast<GPIO_TypeDef*>( portAddress );
+		}
+};
+
+// Pin<>::write timing for gpio_bench_run, each loop writes the pin GPIO_BENCH_WRITES_PER_LOOP times
+template <GPIO_PORT port, GPIO_PIN pin>
+uint32_t gpio_bench_pin_write_cycles (uint32_t numLoops)
+{
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	for ( uint32_t loop = 0; loop < numLoops; loop++ )
+	{
+		for ( uint32_t write = 0; write < GPIO_BENCH_WRITES_PER_LOOP; write += 2 )
+		{
+			Pin<port, pin>::write( true );
+			Pin<port, pin>::write( false );
+		}
+	}
+
+	return DWT->CYCCNT - startCycles;
+}
+
+// compile-time gpio port, for parallel buses and other multi-pin writes that need to change all pins at once
+template <GPIO_PORT port>
+class Port
+{
+	public:
+		static constexpr uint32_t portAddress = gpio_port_address( port );
+
+		static inline void setMask (uint16_t setMask)
+		{
+			portPtr()->BSRR = setMask;
+		}
+
+		static inline void clearMask (uint16_t clearMask)
+		{
+			portPtr()->BSRR = static_cast<uint32_t>( clearMask ) << 16;
+		}
+
+		static inline void writeMask (uint16_t setMask, uint16_t clearMask)
+		{
+			portPtr()->BSRR = setMask | ( static_cast<uint32_t>(clearMask) << 16 );
+		}
+
+		template <GPIO_PIN firstPin, unsigned int numBits>
+		static inline void writeRange (uint16_t value)
+		{
+			static_assert( numBits >= 1 && static_cast<unsigned int>(firstPin) + numBits <= 16, "Pin range exceeds port width" );
+
+			portPtr()->BSRR = gpio_range_bsrr_value( firstPin, numBits, value );
+		}
+
+		static inline uint16_t read()
+		{
+			return portPtr()->IDR;
+		}
+
+	private:
+		static inline GPIO_TypeDef* portPtr()
+		{
+			return reinterpret_cast<GPIO_TypeDef*>( portAddress );
+		}
+};
+
+// compile-time board pin map, folded into one register image per port so bring-up is a single read-modify-write per register
+// instead of several per pin, for example:
+// 	static constexpr GPIO_PIN_CONFIG boardPins[] = { { GPIO_PORT::B, GPIO_PIN::PIN_6, GPIO_MODE::ALT_FUNC, GPIO_PUPD::NONE,
+// 								GPIO_OUTPUT_TYPE::OPEN_DRAIN, GPIO_OUTPUT_SPEED::HIGH, 4 }, ... };
+// 	PinMap<boardPins, sizeof(boardPins) / sizeof(boardPins[0])>::apply();
+template <const GPIO_PIN_CONFIG* pinMap, unsigned int numPins>
+class PinMap
+{
+	static_assert( ! gpio_pin_map_has_conflicts(pinMap, numPins), "Two entries in the pin map claim the same pin" );
+	static_assert( ! gpio_pin_map_has_invalid_af(pinMap, numPins), "Alternate function values must be between 0 and 15" );
+
+	public:
+		static constexpr uint32_t clockMask = gpio_pin_map_clock_mask( pinMap, numPins );
+
+		static constexpr GPIO_PORT_IMAGE portImage (const GPIO_PORT& port)
+		{
+			return gpio_pin_map_port_image( pinMap, numPins, port );
+		}
+
+		static void apply()
+		{
+			// enable the clock for every port in the map at once
+			RCC->AHB4ENR |= clockMask;
+
+			applyPort<GPIO_PORT::A>();
+			applyPort<GPIO_PORT::B>();
+			applyPort<GPIO_PORT::C>();
+			applyPort<GPIO_PORT::D>();
+			applyPort<GPIO_PORT::E>();
+			applyPort<GPIO_PORT::F>();
+			applyPort<GPIO_PORT::G>();
+			applyPort<GPIO_PORT::H>();
+			applyPort<GPIO_PORT::I>();
+			applyPort<GPIO_PORT::J>();
+			applyPort<GPIO_PORT::K>();
+		}
+
+	private:
+		template <GPIO_PORT port>
+		static inline void applyPort()
+		{
+			// ports not in the map compile away entirely
+			static constexpr GPIO_PORT_IMAGE image = portImage( port );
+			if ( image.moderMask != 0 )
+			{
+				LLPD::gpio_apply_port_image( port, image );
+			}
+		}
+};
+
 #endif // LLPD_H
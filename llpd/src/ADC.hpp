@@ -4,15 +4,19 @@
 #include <string.h>
 
 // these arrays are used to hold the values of each channel after a conversion sequence
-static uint32_t* adc12ChannelValues = (uint32_t*) ( ((uint8_t*) D3_SRAM_BASE) + D3_SRAM_TIM6_OFFSET_IN_BYTES );
+static uint32_t* adc12ChannelValues = reinterpret_cast<uint32_t*>( sram_slot_address(SRAM_SLOT::ADC_VALUES) );
 static uint32_t* adc3ChannelValues = adc12ChannelValues + 16;
 static uint8_t  adc12NumChansInSeq = 0;
 static uint8_t  adc3NumChansInSeq = 0;
 
 // these arrays are used to hold the mapping of the channel order to channel number
-static ADC_CHANNEL* adc12ChannelOrder = (ADC_CHANNEL*) ( adc3ChannelValues + 16 );
+static ADC_CHANNEL* adc12ChannelOrder = reinterpret_cast<ADC_CHANNEL*>( sram_slot_address(SRAM_SLOT::ADC_CHANNEL_ORDER) );
 static ADC_CHANNEL* adc3ChannelOrder = adc12ChannelOrder + 16;
 
+// reverse of the order arrays, mapping each channel number to its position in the sequence
+static uint8_t* adc12ChannelRank = reinterpret_cast<uint8_t*>( sram_slot_address(SRAM_SLOT::ADC_CHANNEL_RANK) );
+static uint8_t* adc3ChannelRank = adc12ChannelRank + ADC_NUM_CHANNELS;
+
 static uint8_t adcChannelToNum (const ADC_CHANNEL& channel)
 {
 	uint8_t channelNum = 0;
@@ -214,34 +218,65 @@ static uint32_t orderNumToMask (uint8_t orderNum)
 	return mask;
 }
 
-// TODO add setting cyclesPerSample for fast and slow channels separately
-void LLPD::adc_init (const ADC_NUM& adcNum, const ADC_CYCLES_PER_SAMPLE& cyclesPerSample)
+static uint32_t adcCyclesPerSampleToRegVal (const ADC_CYCLES_PER_SAMPLE& cyclesPerSample)
 {
-	// reset adc registers
-	if ( adcNum == ADC_NUM::ADC_1_2 )
-	{
-		RCC->AHB1RSTR |= RCC_AHB1RSTR_ADC12RST;
-		RCC->AHB1RSTR &= ~(RCC_AHB1RSTR_ADC12RST);
-	}
-	else // ADC_NUM::ADC_3
+	uint32_t clkRegVal = 0;
+
+	switch ( cyclesPerSample )
 	{
-		RCC->AHB4RSTR |= RCC_AHB4RSTR_ADC3RST;
-		RCC->AHB4RSTR &= ~(RCC_AHB4RSTR_ADC3RST);
+		case ADC_CYCLES_PER_SAMPLE::CPS_1p5:
+			clkRegVal = 0b000;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_2p5:
+			clkRegVal = 0b001;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_8p5:
+			clkRegVal = 0b010;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_16p5:
+			clkRegVal = 0b011;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_32p5:
+			clkRegVal = 0b100;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_64p5:
+			clkRegVal = 0b101;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_387p5:
+			clkRegVal = 0b110;
+			break;
+		case ADC_CYCLES_PER_SAMPLE::CPS_810p5:
+			clkRegVal = 0b111;
+			break;
 	}
 
-	// enable clock to adc
+	return clkRegVal;
+}
+
+// channels 0 to 9 are in SMPR1 and 10 to 19 in SMPR2, 3 bits per channel
+static void adcSetSampleTime (ADC_TypeDef* adc, const uint8_t channelNum, const uint32_t clkRegVal)
+{
+	const uint8_t spacing = 3;
+	volatile uint32_t* smpr = ( channelNum < 10 ) ? &( adc->SMPR1 ) : &( adc->SMPR2 );
+	const uint8_t shift = spacing * ( channelNum % 10 );
+
+	*smpr &= ~( 0b111 << shift );
+	*smpr |= ( clkRegVal << shift );
+}
+
+void LLPD::adc_init (const ADC_NUM& adcNum, const ADC_CYCLES_PER_SAMPLE& cyclesPerSample)
+{
+	// reset adc registers and enable clock to adc
+	LLPD::periph_reset( periph_from_adc(adcNum) );
+	LLPD::periph_enable_clock( periph_from_adc(adcNum) );
+
+	// get out of deep-power-down state
 	if ( adcNum == ADC_NUM::ADC_1_2 )
 	{
-		RCC->AHB1ENR |= RCC_AHB1ENR_ADC12EN;
-
-		// get out of deep-power-down state
 		ADC1->CR &= ~(ADC_CR_DEEPPWD);
 	}
 	else // ADC_NUM::ADC_3
 	{
-		RCC->AHB4ENR |= RCC_AHB4ENR_ADC3EN;
-
-		// get out of deep-power-down state
 		ADC3->CR &= ~(ADC_CR_DEEPPWD);
 	}
 
@@ -249,20 +284,37 @@ void LLPD::adc_init (const ADC_NUM& adcNum, const ADC_CYCLES_PER_SAMPLE& cyclesP
 	RCC->D3CCIPR &= ~(RCC_D3CCIPR_ADCSEL);
 	RCC->D3CCIPR |= RCC_D3CCIPR_ADCSEL_1;
 
-	// set clock to use synchronous mode with sys_ck / 2 (since HPRE) / 2 / 4, for a clock speed of 30MHz
+	// set clock to use synchronous mode with hclk / 4 / 2 (the adc divides by 2 internally), 30MHz with the max clock settings
+	const uint32_t adcClockFreq = LLPD::rcc_get_clock_freq( RCC_CLOCK::AHB ) / 8;
+	uint32_t boostVal = 0b11;
+	if ( adcClockFreq <= 6250000 )
+	{
+		boostVal = 0b00;
+	}
+	else if ( adcClockFreq <= 12500000 )
+	{
+		boostVal = 0b01;
+	}
+	else if ( adcClockFreq <= 25000000 )
+	{
+		boostVal = 0b10;
+	}
+
 	if ( adcNum == ADC_NUM::ADC_1_2 )
 	{
 		ADC12_COMMON->CCR |= ADC_CCR_CKMODE;
 
-		// setting boost for 30MHz clock
-		ADC1->CR |= ADC_CR_BOOST;
+		// setting boost for the adc clock
+		ADC1->CR &= ~(ADC_CR_BOOST);
+		ADC1->CR |= boostVal << ADC_CR_BOOST_Pos;
 	}
 	else // ADC_NUM::ADC_3
 	{
 		ADC3_COMMON->CCR |= ADC_CCR_CKMODE;
 
-		// setting boost for 30MHz clock
-		ADC3->CR |= ADC_CR_BOOST;
+		// setting boost for the adc clock
+		ADC3->CR &= ~(ADC_CR_BOOST);
+		ADC3->CR |= boostVal << ADC_CR_BOOST_Pos;
 	}
 
 	// set adcs to combined simultaneous regular and injected mode
@@ -345,110 +397,55 @@ void LLPD::adc_init (const ADC_NUM& adcNum, const ADC_CYCLES_PER_SAMPLE& cyclesP
 		while ( ! (ADC3->ISR & ADC_ISR_ADRDY) ) {}
 	}
 
-	// set cycles per adc sample
-	uint8_t clkRegVal = 0;
-
-	switch ( cyclesPerSample )
+	// set the same cycles per adc sample for every channel, adc_set_channel_order can override them per channel
+	ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+	const uint32_t clkRegVal = adcCyclesPerSampleToRegVal( cyclesPerSample );
+	for ( uint8_t channelNum = 0; channelNum < 20; channelNum++ )
 	{
-		case ADC_CYCLES_PER_SAMPLE::CPS_1p5:
-			clkRegVal = 0b000;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_2p5:
-			clkRegVal = 0b001;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_8p5:
-			clkRegVal = 0b010;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_16p5:
-			clkRegVal = 0b011;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_32p5:
-			clkRegVal = 0b100;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_64p5:
-			clkRegVal = 0b101;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_387p5:
-			clkRegVal = 0b110;
-			break;
-		case ADC_CYCLES_PER_SAMPLE::CPS_810p5:
-			clkRegVal = 0b111;
-			break;
+		adcSetSampleTime( adc, channelNum, clkRegVal );
 	}
 
-	// set each timing clock in sample time registers
-	uint8_t spacing = 3; // 3 bits per entry
-	uint8_t offset = 10; // SMPR2 begins at channel 10
-	if ( adcNum == ADC_NUM::ADC_1_2 )
-	{
-		ADC1->SMPR1 = 	( clkRegVal << (spacing * 0) ) |
-				( clkRegVal << (spacing * 1) ) |
-				( clkRegVal << (spacing * 2) ) |
-				( clkRegVal << (spacing * 3) ) |
-				( clkRegVal << (spacing * 4) ) |
-				( clkRegVal << (spacing * 5) ) |
-				( clkRegVal << (spacing * 6) ) |
-				( clkRegVal << (spacing * 7) ) |
-				( clkRegVal << (spacing * 8) ) |
-				( clkRegVal << (spacing * 9) );
-		ADC1->SMPR2 = 	( clkRegVal << (spacing * (10 - offset)) ) |
-				( clkRegVal << (spacing * (11 - offset)) ) |
-				( clkRegVal << (spacing * (12 - offset)) ) |
-				( clkRegVal << (spacing * (13 - offset)) ) |
-				( clkRegVal << (spacing * (14 - offset)) ) |
-				( clkRegVal << (spacing * (15 - offset)) ) |
-				( clkRegVal << (spacing * (16 - offset)) ) |
-				( clkRegVal << (spacing * (17 - offset)) ) |
-				( clkRegVal << (spacing * (18 - offset)) ) |
-				( clkRegVal << (spacing * (19 - offset)) );
-	}
-	else // ADC_NUM::ADC_3
-	{
-		ADC3->SMPR1 = 	( clkRegVal << (spacing * 0) ) |
-				( clkRegVal << (spacing * 1) ) |
-				( clkRegVal << (spacing * 2) ) |
-				( clkRegVal << (spacing * 3) ) |
-				( clkRegVal << (spacing * 4) ) |
-				( clkRegVal << (spacing * 5) ) |
-				( clkRegVal << (spacing * 6) ) |
-				( clkRegVal << (spacing * 7) ) |
-				( clkRegVal << (spacing * 8) ) |
-				( clkRegVal << (spacing * 9) );
-		ADC3->SMPR2 = 	( clkRegVal << (spacing * (10 - offset)) ) |
-				( clkRegVal << (spacing * (11 - offset)) ) |
-				( clkRegVal << (spacing * (12 - offset)) ) |
-				( clkRegVal << (spacing * (13 - offset)) ) |
-				( clkRegVal << (spacing * (14 - offset)) ) |
-				( clkRegVal << (spacing * (15 - offset)) ) |
-				( clkRegVal << (spacing * (16 - offset)) ) |
-				( clkRegVal << (spacing * (17 - offset)) ) |
-				( clkRegVal << (spacing * (18 - offset)) ) |
-				( clkRegVal << (spacing * (19 - offset)) );
-	}
-
-	// set to 12-bits
-	if ( adcNum == ADC_NUM::ADC_1_2 )
+	// set to 12-bits without oversampling
+	LLPD::adc_set_resolution( adcNum, ADC_RESOLUTION::BITS_12 );
+	LLPD::adc_set_oversampling( adcNum, 1, 0 );
+}
+
+void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, const ADC_CHANNEL& channel...)
+{
+	// ensure valid amount of channels
+	if ( numChannels <= 0 || numChannels > 16 )
 	{
-		ADC1->CFGR &= ~(ADC_CFGR_RES);
-		ADC1->CFGR |= ( ADC_CFGR_RES_2 | ADC_CFGR_RES_1 );
+		return;
 	}
-	else // ADC_NUM::ADC_3
+
+	ADC_CHANNEL channelsInOrder[16];
+	channelsInOrder[0] = channel;
+
+	va_list channels;
+	va_start( channels, channel );
+
+	for ( uint8_t orderNum = 2; orderNum <= numChannels; orderNum++ )
 	{
-		ADC3->CFGR &= ~(ADC_CFGR_RES);
-		ADC3->CFGR |= ( ADC_CFGR_RES_2 | ADC_CFGR_RES_1 );
+		channelsInOrder[orderNum - 1] = va_arg( channels, ADC_CHANNEL );
 	}
+
+	va_end( channels );
+
+	LLPD::adc_set_channel_order( adcNum, numChannels, channelsInOrder );
 }
 
-void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, const ADC_CHANNEL& channel...)
+void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, const ADC_CHANNEL* channelsInOrder,
+					const ADC_CYCLES_PER_SAMPLE* cyclesPerSample)
 {
 	// ensure valid amount of channels
-	if ( numChannels <= 0 || numChannels > 16 )
+	if ( numChannels <= 0 || numChannels > 16 || channelsInOrder == nullptr )
 	{
 		return;
 	}
 
 	// cache the number of channels so we can use this later
 	ADC_CHANNEL* channelOrder = nullptr;
+	uint8_t* channelRank = nullptr;
 	volatile uint32_t* sqr1 = nullptr;
 	volatile uint32_t* sqr2 = nullptr;
 	volatile uint32_t* sqr3 = nullptr;
@@ -458,6 +455,7 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 	{
 		adc12NumChansInSeq = numChannels;
 		channelOrder = adc12ChannelOrder;
+		channelRank = adc12ChannelRank;
 		sqr1 = &( ADC1->SQR1 );
 		sqr2 = &( ADC1->SQR2 );
 		sqr3 = &( ADC1->SQR3 );
@@ -468,6 +466,7 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 	{
 		adc3NumChansInSeq = numChannels;
 		channelOrder = adc3ChannelOrder;
+		channelRank = adc3ChannelRank;
 		sqr1 = &( ADC3->SQR1 );
 		sqr2 = &( ADC3->SQR2 );
 		sqr3 = &( ADC3->SQR3 );
@@ -481,16 +480,19 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 		channelOrder[chanNum] = ADC_CHANNEL::CHAN_INVALID;
 	}
 
+	// reset 'rank' array
+	for ( uint8_t chanNum = 0; chanNum < ADC_NUM_CHANNELS; chanNum++ )
+	{
+		channelRank[chanNum] = ADC_CHANNEL_NO_RANK;
+	}
+
 	// set number of channels in sequence
 	uint8_t numChannelsOffset = numChannels - 1;
 	*sqr1 &= ~(ADC_SQR1_L);
 	*sqr1 |= ( 0x0000000F & numChannelsOffset );
 
-	va_list channels;
-	va_start( channels, channel );
-
 	// order first channel
-	ADC_CHANNEL chanFirst = channel;
+	ADC_CHANNEL chanFirst = channelsInOrder[0];
 	uint8_t chanFirstNum = adcChannelToNum( chanFirst );
 
 	// add channel to preselection
@@ -499,13 +501,14 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 	*sqr1 &= ~(ADC_SQR1_SQ1);
 	*sqr1 |= ( chanFirstNum << ADC_SQR1_SQ1_Pos );
 
-	// add first channel to the 'order' array
+	// add first channel to the 'order' and 'rank' arrays
 	channelOrder[0] = chanFirst;
+	channelRank[chanFirstNum] = 0;
 
 	// oder rest of channels
 	for ( uint8_t orderNum = 2; orderNum <= numChannels; orderNum++ )
 	{
-		ADC_CHANNEL chanEnum = va_arg( channels, ADC_CHANNEL );
+		ADC_CHANNEL chanEnum = channelsInOrder[orderNum - 1];
 		uint32_t mask = orderNumToMask( orderNum );
 		uint8_t position = orderNumToPos( orderNum );
 		uint8_t chan = adcChannelToNum( chanEnum );
@@ -513,8 +516,12 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 		// add channel to preselection
 		*pcsel |= (1 << chan);
 
-		// add channel to the 'order' array
+		// add channel to the 'order' array, and to the 'rank' array if it isn't already earlier in the sequence
 		channelOrder[orderNum - 1] = chanEnum;
+		if ( channelRank[chan] == ADC_CHANNEL_NO_RANK )
+		{
+			channelRank[chan] = orderNum - 1;
+		}
 
 		// we need to use different registers depending on the order number
 		if ( orderNum < 5 )
@@ -539,17 +546,26 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 		}
 	}
 
-	va_end( channels );
+	// sample times are per channel rather than per position, so a channel in the sequence twice uses its last sample time
+	if ( cyclesPerSample != nullptr )
+	{
+		ADC_TypeDef* adcForSampleTimes = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+		for ( uint8_t orderNum = 0; orderNum < numChannels; orderNum++ )
+		{
+			adcSetSampleTime( adcForSampleTimes, adcChannelToNum(channelsInOrder[orderNum]),
+						adcCyclesPerSampleToRegVal(cyclesPerSample[orderNum]) );
+		}
+	}
 
 	// enable syscfg clock
-	RCC->APB4ENR |= RCC_APB4ENR_SYSCFGEN;
+	LLPD::periph_enable_clock( PERIPH::SYS_CFG );
 
 	// set up dma (use dma1 channel 0 for adc12 and bdma channel 0 for adc3)
 	ADC_TypeDef* adc = nullptr;
 	if ( adcNum == ADC_NUM::ADC_1_2 )
 	{
 		// enable dma1 clock
-		RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+		LLPD::periph_enable_clock( PERIPH::DMA_1 );
 
 		// ensure dma stream is disabled and control register is reset
 		DMA1_Stream0->CR = 0;
@@ -565,6 +581,7 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 
 		// clear memory for adc data
 		memset( adc12ChannelValues, 0, 16 * sizeof(*adc12ChannelValues) );
+		LLPD::cache_clean_invalidate_range( adc12ChannelValues, 16 * sizeof(*adc12ChannelValues) );
 
 		// configure the number of data to be transferred
 		DMA1_Stream0->NDTR = numChannels;
@@ -588,12 +605,12 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 		DMA1_Stream0->FCR &= ~(DMA_SxFCR_DMDIS);
 
 		// set up dma request input
-		DMAMUX1_Channel0->CCR = 9; // 9 is the dma request mux input for adc1 (as per reference manual)
+		DMAMUX1_Channel0->CCR = periph_desc( PERIPH::ADC_1_2 ).dmaReqRx;
 	}
 	else // ADC_NUM::ADC_3
 	{
 		// enable bdma clock
-		RCC->AHB4ENR |= RCC_AHB4ENR_BDMAEN;
+		LLPD::periph_enable_clock( PERIPH::BDMA_1 );
 
 		// ensure bdma is disabled and control register is reset
 		BDMA_Channel0->CCR = 0;
@@ -609,6 +626,7 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 
 		// clear memory for adc data
 		memset( adc3ChannelValues, 0, 16 * sizeof(*adc3ChannelValues) );
+		LLPD::cache_clean_invalidate_range( adc3ChannelValues, 16 * sizeof(*adc3ChannelValues) );
 
 		// configure the number of data to be transferred
 		BDMA_Channel0->CNDTR = numChannels;
@@ -629,7 +647,7 @@ void LLPD::adc_set_channel_order (const ADC_NUM& adcNum, uint8_t numChannels, co
 		BDMA_Channel0->CCR |= BDMA_CCR_MSIZE_1;
 
 		// set up dma request input
-		DMAMUX2_Channel0->CCR = 17; // 17 is the dma request mux input for adc3 (as per reference manual)
+		DMAMUX2_Channel0->CCR = periph_desc( PERIPH::ADC_3 ).dmaReqRx;
 	}
 
 
@@ -685,32 +703,313 @@ void LLPD::adc_perform_conversion_sequence (const ADC_NUM& adcNum)
 	// wait for the end of sequence to ensure the last transfer was completed
 	while ( ! (adc->ISR & ADC_ISR_EOS) ) {}
 
+	// drop any stale cached copies of the values the dma just wrote
+	LLPD::cache_invalidate_range( (adcNum == ADC_NUM::ADC_1_2) ? adc12ChannelValues : adc3ChannelValues, 16 * sizeof(uint32_t) );
+
 	// clear end of sequence flag
 	adc->ISR |= ADC_ISR_EOS;
 }
 
 uint16_t LLPD::adc_get_channel_value (const ADC_NUM& adcNum, const ADC_CHANNEL& channel)
 {
-	uint32_t* channelValues = nullptr;
-	ADC_CHANNEL* channelOrder = nullptr;
+	// also guards against the ranks in d3 sram not having been set up yet
+	const uint8_t rank = LLPD::adc_get_channel_rank( adcNum, channel );
+	if ( rank >= 16 )
+	{
+		return 0;
+	}
+
+	return LLPD::adc_get_frame( adcNum )[rank];
+}
+
+uint8_t LLPD::adc_get_channel_rank (const ADC_NUM& adcNum, const ADC_CHANNEL& channel)
+{
+	const unsigned int chanNum = static_cast<unsigned int>( channel );
+	if ( chanNum >= ADC_NUM_CHANNELS )
+	{
+		return ADC_CHANNEL_NO_RANK;
+	}
+
+	return ( adcNum == ADC_NUM::ADC_1_2 ) ? adc12ChannelRank[chanNum] : adc3ChannelRank[chanNum];
+}
+
+const uint32_t* LLPD::adc_get_frame (const ADC_NUM& adcNum)
+{
+	return ( adcNum == ADC_NUM::ADC_1_2 ) ? adc12ChannelValues : adc3ChannelValues;
+}
+
+uint8_t LLPD::adc_get_num_channels_in_sequence (const ADC_NUM& adcNum)
+{
+	return ( adcNum == ADC_NUM::ADC_1_2 ) ? adc12NumChansInSeq : adc3NumChansInSeq;
+}
+
+// empty callback so the isrs never need to check for null
+static void adcNoCallback (const uint32_t*, unsigned int) {}
+
+// continuous mode state, the dma fills the two halves of the buffer in turn
+struct AdcContinuous
+{
+	uint32_t* 	buffer = nullptr;
+	unsigned int 	numFramesPerHalf = 0;
+	unsigned int 	numWordsPerHalf = 0;
+	void (*halfCallback)(const uint32_t* frames, unsigned int numFrames) = adcNoCallback;
+	void (*fullCallback)(const uint32_t* frames, unsigned int numFrames) = adcNoCallback;
+};
+
+static AdcContinuous adcContinuous[2];
+
+// called from the dma isrs once a half of the buffer is filled, firstHalf selects which half
+static inline void adcContinuousHalfFilled (const ADC_NUM& adcNum, const bool firstHalf)
+{
+	AdcContinuous& continuous = adcContinuous[static_cast<unsigned int>( adcNum )];
+	uint32_t* frames = firstHalf ? continuous.buffer : continuous.buffer + continuous.numWordsPerHalf;
+
+	// drop any stale cached copies, the start checks that the halves are on whole cache lines
+	LLPD::cache_invalidate_range( frames, continuous.numWordsPerHalf * sizeof(uint32_t) );
+
+	if ( firstHalf )
+	{
+		continuous.halfCallback( frames, continuous.numFramesPerHalf );
+	}
+	else
+	{
+		continuous.fullCallback( frames, continuous.numFramesPerHalf );
+	}
+}
+
+static void adcStopConversion (ADC_TypeDef* adc)
+{
+	if ( adc->CR & ADC_CR_ADSTART )
+	{
+		adc->CR |= ADC_CR_ADSTP;
+		while ( adc->CR & ADC_CR_ADSTART ) {}
+	}
+}
+
+bool LLPD::adc_start_continuous (const ADC_NUM& adcNum, uint32_t* buffer, unsigned int numFramesPerHalf,
+					void (*halfCallback)(const uint32_t* frames, unsigned int numFrames),
+					void (*fullCallback)(const uint32_t* frames, unsigned int numFrames), uint8_t priority)
+{
+	const uint8_t numChannels = ( adcNum == ADC_NUM::ADC_1_2 ) ? adc12NumChansInSeq : adc3NumChansInSeq;
+	const uint32_t numWordsPerHalf = numFramesPerHalf * numChannels;
+	const uint32_t numBytesPerHalf = numWordsPerHalf * sizeof(uint32_t);
+	if ( buffer == nullptr || numChannels == 0 || numFramesPerHalf == 0 || numWordsPerHalf * 2 > 0xFFFF )
+	{
+		return false;
+	}
+
+	// the bdma can only reach d3 memory
+	const uint32_t bufferAddress = reinterpret_cast<uint32_t>( buffer );
+	if ( adcNum == ADC_NUM::ADC_3 && (bufferAddress < D3_SRAM_BASE
+				|| bufferAddress + (numBytesPerHalf * 2) > D3_SRAM_BASE + D3_SRAM_SIZE_IN_BYTES) )
+	{
+		return false;
+	}
+
+	// each half is invalidated while the dma writes the other one, so the halves can't share a cache line
+	if ( LLPD::cache_dcache_is_enabled() && ! LLPD::cache_range_is_aligned(buffer, numBytesPerHalf) )
+	{
+		return false;
+	}
+
+	ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+	adcStopConversion( adc );
+
+	AdcContinuous& continuous = adcContinuous[static_cast<unsigned int>( adcNum )];
+	continuous.buffer = buffer;
+	continuous.numFramesPerHalf = numFramesPerHalf;
+	continuous.numWordsPerHalf = numWordsPerHalf;
+	continuous.halfCallback = ( halfCallback != nullptr ) ? halfCallback : adcNoCallback;
+	continuous.fullCallback = ( fullCallback != nullptr ) ? fullCallback : adcNoCallback;
+
+	// dirty lines evicted during the transfer would overwrite the samples
+	LLPD::cache_invalidate_range( buffer, numBytesPerHalf * 2 );
+
+	// point the dma set up in adc_set_channel_order at the buffer, in circular mode with half and full transfer interrupts
 	if ( adcNum == ADC_NUM::ADC_1_2 )
 	{
-		channelValues = adc12ChannelValues;
-		channelOrder = adc12ChannelOrder;
+		DMA1_Stream0->CR &= ~(DMA_SxCR_EN);
+		while ( DMA1_Stream0->CR & DMA_SxCR_EN ) {}
+
+		DMA1->LIFCR = DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+
+		DMA1_Stream0->M0AR = (uint64_t) buffer;
+		DMA1_Stream0->NDTR = numWordsPerHalf * 2;
+		DMA1_Stream0->CR |= DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+		NVIC_SetPriority( DMA1_Stream0_IRQn, priority );
+		NVIC_EnableIRQ( DMA1_Stream0_IRQn );
+
+		DMA1_Stream0->CR |= DMA_SxCR_EN;
 	}
 	else // ADC_NUM::ADC_3
 	{
-		channelValues = adc3ChannelValues;
-		channelOrder = adc3ChannelOrder;
+		BDMA_Channel0->CCR &= ~(BDMA_CCR_EN);
+		while ( BDMA_Channel0->CCR & BDMA_CCR_EN ) {}
+
+		BDMA->IFCR = BDMA_IFCR_CGIF0 | BDMA_IFCR_CTCIF0 | BDMA_IFCR_CHTIF0 | BDMA_IFCR_CTEIF0;
+
+		BDMA_Channel0->CM0AR = (uint64_t) buffer;
+		BDMA_Channel0->CNDTR = numWordsPerHalf * 2;
+		BDMA_Channel0->CCR |= BDMA_CCR_CIRC | BDMA_CCR_HTIE | BDMA_CCR_TCIE;
+
+		NVIC_SetPriority( BDMA_Channel0_IRQn, priority );
+		NVIC_EnableIRQ( BDMA_Channel0_IRQn );
+
+		BDMA_Channel0->CCR |= BDMA_CCR_EN;
 	}
 
-	for ( uint8_t index = 0; index < 16; index++ )
+	// set up adc to use dma circular mode, converting back to back unless a trigger paces the sequences
+	adc->CFGR &= ~(ADC_CFGR_DMNGT);
+	adc->CFGR |= ADC_CFGR_DMNGT_0 | ADC_CFGR_DMNGT_1;
+	if ( ! (adc->CFGR & ADC_CFGR_EXTEN) )
 	{
-		if ( channel == channelOrder[index] )
-		{
-			return channelValues[index];
-		}
+		adc->CFGR |= ADC_CFGR_CONT;
+	}
+
+	// clear flags and start conversions
+	adc->ISR |= ADC_ISR_EOS | ADC_ISR_OVR;
+	adc->CR |= ADC_CR_ADSTART;
+
+	return true;
+}
+
+void LLPD::adc_stop_continuous (const ADC_NUM& adcNum)
+{
+	ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+	adcStopConversion( adc );
+
+	// back to dma one-shot mode
+	adc->CFGR &= ~( ADC_CFGR_DMNGT | ADC_CFGR_CONT );
+	adc->CFGR |= ADC_CFGR_DMNGT_0;
+
+	// put the dma back the way adc_set_channel_order left it, so adc_perform_conversion_sequence works again
+	if ( adcNum == ADC_NUM::ADC_1_2 )
+	{
+		NVIC_DisableIRQ( DMA1_Stream0_IRQn );
+
+		DMA1_Stream0->CR &= ~( DMA_SxCR_EN | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE );
+		while ( DMA1_Stream0->CR & DMA_SxCR_EN ) {}
+
+		DMA1->LIFCR = DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+		DMA1_Stream0->M0AR = (uint64_t) adc12ChannelValues;
+	}
+	else // ADC_NUM::ADC_3
+	{
+		NVIC_DisableIRQ( BDMA_Channel0_IRQn );
+
+		BDMA_Channel0->CCR &= ~( BDMA_CCR_EN | BDMA_CCR_CIRC | BDMA_CCR_HTIE | BDMA_CCR_TCIE );
+		while ( BDMA_Channel0->CCR & BDMA_CCR_EN ) {}
+
+		BDMA->IFCR = BDMA_IFCR_CGIF0 | BDMA_IFCR_CTCIF0 | BDMA_IFCR_CHTIF0 | BDMA_IFCR_CTEIF0;
+		BDMA_Channel0->CM0AR = (uint64_t) adc3ChannelValues;
+	}
+
+	AdcContinuous& continuous = adcContinuous[static_cast<unsigned int>( adcNum )];
+	continuous.buffer = nullptr;
+	continuous.halfCallback = adcNoCallback;
+	continuous.fullCallback = adcNoCallback;
+}
+
+void LLPD::adc_set_trigger (const ADC_NUM& adcNum, const ADC_TRIGGER& trigger, const ADC_TRIGGER_EDGE& edge)
+{
+	ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+
+	// the trigger can only be changed while no conversion is running
+	adcStopConversion( adc );
+
+	adc->CFGR &= ~( ADC_CFGR_EXTSEL | ADC_CFGR_EXTEN );
+	if ( edge != ADC_TRIGGER_EDGE::SOFTWARE )
+	{
+		adc->CFGR |= ( static_cast<uint32_t>(trigger) << ADC_CFGR_EXTSEL_Pos ) | ( static_cast<uint32_t>(edge) << ADC_CFGR_EXTEN_Pos );
+	}
+}
+
+// sample time register values to adc clock cycles
+static constexpr float ADC_SAMPLE_CYCLES[8] = { 1.5f, 2.5f, 8.5f, 16.5f, 32.5f, 64.5f, 387.5f, 810.5f };
+
+// successive approximation cycles for the resolution in RES
+static float adcConversionCycles (const ADC_TypeDef* adc)
+{
+	switch ( (adc->CFGR & ADC_CFGR_RES) >> ADC_CFGR_RES_Pos )
+	{
+		case 0b101: // 14 bits
+			return 7.5f;
+		case 0b110: // 12 bits
+			return 6.5f;
+		case 0b011: // 10 bits
+			return 5.5f;
+		case 0b111: // 8 bits
+			return 4.5f;
+		default: // 16 bits
+			return 8.5f;
+	}
+}
+
+float LLPD::adc_get_sequence_cycles (const ADC_NUM& adcNum)
+{
+	const ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+	const ADC_CHANNEL* channelOrder = ( adcNum == ADC_NUM::ADC_1_2 ) ? adc12ChannelOrder : adc3ChannelOrder;
+	const uint8_t numChannels = ( adcNum == ADC_NUM::ADC_1_2 ) ? adc12NumChansInSeq : adc3NumChansInSeq;
+
+	float cycles = 0.0f;
+	for ( uint8_t orderNum = 0; orderNum < numChannels; orderNum++ )
+	{
+		const uint8_t channelNum = adcChannelToNum( channelOrder[orderNum] );
+		const uint32_t smpr = ( channelNum < 10 ) ? adc->SMPR1 : adc->SMPR2;
+		cycles += ADC_SAMPLE_CYCLES[( smpr >> (3 * (channelNum % 10)) ) & 0b111] + adcConversionCycles( adc );
+	}
+
+	// every result takes ratio conversions with oversampling enabled
+	if ( adc->CFGR2 & ADC_CFGR2_ROVSE )
+	{
+		cycles *= ( (adc->CFGR2 & ADC_CFGR2_OVSR) >> ADC_CFGR2_OVSR_Pos ) + 1;
 	}
 
-	return 0;
+	return cycles;
+}
+
+void LLPD::adc_set_resolution (const ADC_NUM& adcNum, const ADC_RESOLUTION& resolution)
+{
+	ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+
+	// the resolution can only be changed while no conversion is running
+	adcStopConversion( adc );
+
+	adc->CFGR &= ~(ADC_CFGR_RES);
+	adc->CFGR |= static_cast<uint32_t>( resolution ) << ADC_CFGR_RES_Pos;
+}
+
+bool LLPD::adc_set_oversampling (const ADC_NUM& adcNum, unsigned int ratio, uint8_t rightShift, const ADC_OVERSAMPLING_MODE& mode)
+{
+	if ( ratio == 0 || ratio > ADC_MAX_OVERSAMPLING_RATIO || rightShift > ADC_MAX_OVERSAMPLING_SHIFT )
+	{
+		return false;
+	}
+
+	ADC_TypeDef* adc = ( adcNum == ADC_NUM::ADC_1_2 ) ? ADC1 : ADC3;
+
+	// the oversampling settings can only be changed while no conversion is running
+	adcStopConversion( adc );
+
+	adc->CFGR2 &= ~( ADC_CFGR2_ROVSE | ADC_CFGR2_OVSS | ADC_CFGR2_TROVS | ADC_CFGR2_ROVSM | ADC_CFGR2_OVSR );
+	if ( ratio == 1 )
+	{
+		return true;
+	}
+
+	adc->CFGR2 |= ( (ratio - 1) << ADC_CFGR2_OVSR_Pos ) | ( static_cast<uint32_t>(rightShift) << ADC_CFGR2_OVSS_Pos );
+
+	if ( mode == ADC_OVERSAMPLING_MODE::RESUMED )
+	{
+		adc->CFGR2 |= ADC_CFGR2_ROVSM;
+	}
+	else if ( mode == ADC_OVERSAMPLING_MODE::TRIGGERED )
+	{
+		adc->CFGR2 |= ADC_CFGR2_TROVS;
+	}
+
+	adc->CFGR2 |= ADC_CFGR2_ROVSE;
+
+	return true;
 }
@@ -0,0 +1,105 @@
+#include "LLPD.hpp"
+
+// the cortex-m4 has no caches (only the flash art accelerator), so the maintenance functions do nothing there
+#ifndef CORE_CM4
+static_assert( CACHE_LINE_SIZE == __SCB_DCACHE_LINE_SIZE, "CACHE_LINE_SIZE doesn't match the cortex-m7 d-cache" );
+#endif
+
+static constexpr uint32_t CACHE_LINE_MASK = CACHE_LINE_SIZE - 1;
+
+void LLPD::cache_enable()
+{
+#ifndef CORE_CM4
+	// state shared with cpu2 lives in the sram slots, which would go stale in a write-back cache
+	LLPD::mpu_configure_region( mpu_profile_dma_buffer(MPU_REGION_D3_SLOTS, sram_region_base(SRAM_REGION::D3),
+								sram_region_mpu_size(SRAM_REGION::D3)) );
+	LLPD::mpu_configure_region( mpu_profile_dma_buffer(MPU_REGION_D2_SHARED_SLOTS, sram_region_base(SRAM_REGION::D2_SHARED),
+								sram_region_mpu_size(SRAM_REGION::D2_SHARED)) );
+	LLPD::mpu_enable();
+
+	// both caches are invalidated before being enabled, already enabled caches are left alone
+	SCB_EnableICache();
+	SCB_EnableDCache();
+#endif
+}
+
+bool LLPD::cache_dcache_is_enabled()
+{
+#ifdef CORE_CM4
+	return false;
+#else
+	return SCB->CCR & SCB_CCR_DC_Msk;
+#endif
+}
+
+bool LLPD::cache_range_is_aligned (const void* address, uint32_t numBytes)
+{
+	return ( (reinterpret_cast<uint32_t>(address) | numBytes) & CACHE_LINE_MASK ) == 0;
+}
+
+void LLPD::cache_clean_range (const void* address, uint32_t numBytes)
+{
+#ifndef CORE_CM4
+	if ( numBytes == 0 )
+	{
+		return;
+	}
+
+	// cleaning only writes back dirty lines, so partial lines at the ends are fine
+	SCB_CleanDCache_by_Addr( const_cast<uint32_t*>(static_cast<const uint32_t*>(address)), numBytes );
+#else
+	(void) address;
+	(void) numBytes;
+#endif
+}
+
+bool LLPD::cache_invalidate_range (void* address, uint32_t numBytes)
+{
+	const bool aligned = LLPD::cache_range_is_aligned( address, numBytes );
+
+#ifndef CORE_CM4
+	if ( numBytes == 0 )
+	{
+		return aligned;
+	}
+
+	uint32_t start = reinterpret_cast<uint32_t>( address );
+	uint32_t end = start + numBytes;
+	const uint32_t alignedStart = ( start + CACHE_LINE_MASK ) & ~(CACHE_LINE_MASK);
+	const uint32_t alignedEnd = end & ~(CACHE_LINE_MASK);
+
+	// partial lines at the ends may hold other dirty data, so they're written back instead of being discarded
+	if ( start != alignedStart )
+	{
+		SCB_CleanInvalidateDCache_by_Addr( reinterpret_cast<uint32_t*>(start & ~(CACHE_LINE_MASK)), CACHE_LINE_SIZE );
+		start = alignedStart;
+	}
+	if ( end != alignedEnd && alignedEnd >= start )
+	{
+		SCB_CleanInvalidateDCache_by_Addr( reinterpret_cast<uint32_t*>(alignedEnd), CACHE_LINE_SIZE );
+		end = alignedEnd;
+	}
+
+	if ( end > start )
+	{
+		SCB_InvalidateDCache_by_Addr( reinterpret_cast<void*>(start), end - start );
+	}
+#endif
+
+	return aligned;
+}
+
+void LLPD::cache_clean_invalidate_range (void* address, uint32_t numBytes)
+{
+#ifndef CORE_CM4
+	if ( numBytes == 0 )
+	{
+		return;
+	}
+
+	SCB_CleanInvalidateDCache_by_Addr( static_cast<uint32_t*>(address), numBytes );
+#else
+	(void) address;
+	(void) numBytes;
+#endif
+}
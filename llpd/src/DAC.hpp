@@ -1,13 +1,14 @@
 #include "LLPD.hpp"
 
+static unsigned int dacDmaNumSamplesPerBuf = 0;
+
 void LLPD::dac_init (bool useVoltageBuffer)
 {
 	// enable clock to dac
-	RCC->APB1LENR |= RCC_APB1LENR_DAC12EN;
+	LLPD::periph_enable_clock( PERIPH::DAC_1 );
 
 	// reset dac
-	RCC->APB1LRSTR |= RCC_APB1LRSTR_DAC12RST;
-	RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_DAC12RST);
+	LLPD::periph_reset( PERIPH::DAC_1 );
 
 	// set pins a4 and a5 to analog mode
 	LLPD::gpio_analog_setup( GPIO_PORT::A, GPIO_PIN::PIN_4 );
@@ -32,11 +33,10 @@ void LLPD::dac_init (bool useVoltageBuffer)
 void LLPD::dac_init_use_dma (bool useVoltageBuffer, uint32_t* buffer1, uint32_t* buffer2, unsigned int numSamplesPerBuf)
 {
 	// enable clock to dac
-	RCC->APB1LENR |= RCC_APB1LENR_DAC12EN;
+	LLPD::periph_enable_clock( PERIPH::DAC_1 );
 
 	// reset dac
-	RCC->APB1LRSTR |= RCC_APB1LRSTR_DAC12RST;
-	RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_DAC12RST);
+	LLPD::periph_reset( PERIPH::DAC_1 );
 
 	// set pins a4 and a5 to analog mode
 	LLPD::gpio_analog_setup( GPIO_PORT::A, GPIO_PIN::PIN_4 );
@@ -49,10 +49,10 @@ void LLPD::dac_init_use_dma (bool useVoltageBuffer, uint32_t* buffer1, uint32_t*
 	DAC1->CR |= ( 5 << DAC_CR_TSEL1_Pos ); // only selecting trigger for channel one since only one dma request is needed
 
 	// enable syscfg clock for DMA
-	RCC->APB4ENR |= RCC_APB4ENR_SYSCFGEN;
+	LLPD::periph_enable_clock( PERIPH::SYS_CFG );
 
 	// enable dma1 clock
-	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	LLPD::periph_enable_clock( PERIPH::DMA_1 );
 
 	// ensure dma stream is disabled and control register is reset
 	DMA1_Stream1->CR = 0;
@@ -81,6 +81,11 @@ void LLPD::dac_init_use_dma (bool useVoltageBuffer, uint32_t* buffer1, uint32_t*
 	DMA1_Stream1->M0AR = (uint64_t) buffer1;
 	DMA1_Stream1->M1AR = (uint64_t) buffer2;
 
+	// write the initial samples back to memory, the buffers are cleaned again in dac_dma_buffer_filled
+	dacDmaNumSamplesPerBuf = numSamplesPerBuf;
+	LLPD::dac_dma_buffer_filled( buffer1 );
+	LLPD::dac_dma_buffer_filled( buffer2 );
+
 	// configure the number of data to be transferred
 	DMA1_Stream1->NDTR = numSamplesPerBuf;
 
@@ -92,7 +97,7 @@ void LLPD::dac_init_use_dma (bool useVoltageBuffer, uint32_t* buffer1, uint32_t*
 	DMA1_Stream1->CR |= DMA_SxCR_PL;
 
 	// set up dma request input
-	DMAMUX1_Channel1->CCR = 67; 	// 67 is the dma request mux input for dac_ch1_dma
+	DMAMUX1_Channel1->CCR = periph_desc( PERIPH::DAC_1 ).dmaReqTx;
 
 	// set direct mode
 	DMA1_Stream1->FCR &= ~(DMA_SxFCR_DMDIS);
@@ -128,6 +133,11 @@ void LLPD::dac_send (uint16_t ch1Data, uint16_t ch2Data)
 	DAC1->DHR12RD = ( (ch1Data & 0b0000111111111111) | ((ch2Data & 0b0000111111111111) << 16) );
 }
 
+void LLPD::dac_dma_buffer_filled (const uint32_t* buffer)
+{
+	LLPD::cache_clean_range( buffer, dacDmaNumSamplesPerBuf * sizeof(uint32_t) );
+}
+
 bool LLPD::dac_dma_using_buffer1()
 {
 	return DMA1_Stream1->CR & DMA_SxCR_CT;
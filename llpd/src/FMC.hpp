@@ -100,7 +100,276 @@ void LLPD::fmc_sdram_start (const bool startBank1, const bool startBank2, const
 	modeReg |= bankSelection | ( 0b100 << FMC_SDCMR_MODE_Pos ) | ( modeRegisterVal << FMC_SDCMR_MRD_Pos );
 	FMC_Bank5_6_R->SDCMR = modeReg;
 
-	// set refresh rate counter
-	unsigned int refreshRate = ( (static_cast<float>(tREFInMilliseconds * 1000) / static_cast<float>(numRows)) * clkRateInMHz ) - 20.0f;
+	// set refresh rate counter, the refresh period per row in cycles minus a 20 cycle safety margin
+	const uint64_t cyclesPerRow = ( static_cast<uint64_t>(tREFInMilliseconds) * 1000 * clkRateInMHz ) / numRows;
+	const uint32_t refreshRate = ( cyclesPerRow > 20 ) ? static_cast<uint32_t>( cyclesPerRow - 20 ) : 0;
 	FMC_Bank5_6_R->SDRTR = refreshRate << FMC_SDRTR_COUNT_Pos;
 }
+
+static uint32_t getSdclkFreq (const FMC_SDRAM_CLOCK_CONFIG& clkConfig)
+{
+	if ( clkConfig == FMC_SDRAM_CLOCK_CONFIG::DISABLED )
+	{
+		return 0;
+	}
+
+	return LLPD::rcc_get_fmc_kernel_freq() / static_cast<uint32_t>( clkConfig );
+}
+
+bool LLPD::fmc_sdram_init (const FMC_SDRAM_BANK& bank, const FMC_SDRAM_CHIP_PROFILE& chip, const FMC_SDRAM_CLOCK_CONFIG& clkConfig,
+				const bool burstRead, const FMC_SDRAM_RPIPE_DELAY& rPipeDelay)
+{
+	const FMC_SDRAM_TIMINGS timings = fmc_sdram_solve_timings( chip, getSdclkFreq(clkConfig) );
+	if ( ! timings.valid )
+	{
+		return false;
+	}
+
+	// the timing fields hold the number of cycles - 1
+	LLPD::fmc_sdram_init( bank, chip.colBits, chip.rowBits, chip.dataBits, chip.numBanks, clkConfig, timings.casLatency, burstRead,
+				rPipeDelay, false, timings.tMRD - 1, timings.tXSR - 1, timings.tRAS - 1, timings.tRC - 1, timings.tWR - 1,
+				timings.tRP - 1, timings.tRCD - 1 );
+
+	// sdclk, burst read, read pipe delay, trc and trp are only taken from the first bank's registers
+	if ( bank == FMC_SDRAM_BANK::BANK_6 )
+	{
+		FMC_Bank5_6_R->SDCR[0] &= ~( FMC_SDCRx_SDCLK | FMC_SDCRx_RBURST | FMC_SDCRx_RPIPE );
+		FMC_Bank5_6_R->SDCR[0] |= ( static_cast<uint32_t>(clkConfig) << FMC_SDCRx_SDCLK_Pos )
+						| ( static_cast<uint32_t>(rPipeDelay) << FMC_SDCRx_RPIPE_Pos );
+		if ( burstRead )
+		{
+			FMC_Bank5_6_R->SDCR[0] |= FMC_SDCRx_RBURST;
+		}
+		FMC_Bank5_6_R->SDTR[0] &= ~( FMC_SDTRx_TRC | FMC_SDTRx_TRP );
+		FMC_Bank5_6_R->SDTR[0] |= ( (timings.tRC - 1) << FMC_SDTRx_TRC_Pos ) | ( (timings.tRP - 1) << FMC_SDTRx_TRP_Pos );
+	}
+
+	return true;
+}
+
+uint32_t LLPD::fmc_sdram_get_clock_freq()
+{
+	// the sdclk setting is only taken from the first bank's register
+	return getSdclkFreq( static_cast<FMC_SDRAM_CLOCK_CONFIG>((FMC_Bank5_6_R->SDCR[0] & FMC_SDCRx_SDCLK) >> FMC_SDCRx_SDCLK_Pos) );
+}
+
+void LLPD::fmc_sdram_start (const bool startBank1, const bool startBank2, const FMC_SDRAM_CHIP_PROFILE& chip)
+{
+	const uint32_t sdclkFreq = LLPD::fmc_sdram_get_clock_freq();
+	const FMC_SDRAM_TIMINGS timings = fmc_sdram_solve_timings( chip, sdclkFreq );
+
+	LLPD::fmc_sdram_start( startBank1, startBank2, chip.numAutoRefresh, chip.tREFInMilliseconds, chip.numRows, sdclkFreq / 1000000,
+				timings.modeRegister );
+
+	// the refresh count from the exact frequency rather than whole megahertz
+	FMC_Bank5_6_R->SDRTR = timings.refreshCount << FMC_SDRTR_COUNT_Pos;
+}
+
+static constexpr uint32_t FMC_SDRAM_BANK_SIZE_IN_BYTES = 0x10000000;
+static constexpr uint32_t FMC_SDRAM_NUM_DMA_STREAMS = 8;
+static constexpr uint32_t FMC_SDRAM_DMA_STREAM_STRIDE = DMA1_Stream1_BASE - DMA1_Stream0_BASE;
+static constexpr uint32_t FMC_SDRAM_NUM_MDMA_CHANNELS = 16;
+static constexpr uint32_t FMC_SDRAM_MDMA_CHANNEL_STRIDE = MDMA_Channel1_BASE - MDMA_Channel0_BASE;
+static constexpr uint32_t FMC_SDRAM_MODE_TIMEOUT_CYCLES = 1000000;
+
+static volatile uint32_t fmcSdramTransitionCycles = 0;
+
+static bool addressIsInSdramBanks (const uint32_t address, const bool bank1, const bool bank2)
+{
+	const uint32_t bank5Base = fmc_sdram_bank_address( FMC_SDRAM_BANK::BANK_5 );
+	const uint32_t bank6Base = fmc_sdram_bank_address( FMC_SDRAM_BANK::BANK_6 );
+
+	return ( bank1 && address >= bank5Base && address - bank5Base < FMC_SDRAM_BANK_SIZE_IN_BYTES )
+		|| ( bank2 && address >= bank6Base && address - bank6Base < FMC_SDRAM_BANK_SIZE_IN_BYTES );
+}
+
+static bool dmaStreamsTargetSdram (const uint32_t stream0Base, const bool bank1, const bool bank2)
+{
+	for ( uint32_t streamNum = 0; streamNum < FMC_SDRAM_NUM_DMA_STREAMS; streamNum++ )
+	{
+		const DMA_Stream_TypeDef* stream = reinterpret_cast<DMA_Stream_TypeDef*>( stream0Base
+												+ (streamNum * FMC_SDRAM_DMA_STREAM_STRIDE) );
+		if ( (stream->CR & DMA_SxCR_EN) && (addressIsInSdramBanks(stream->PAR, bank1, bank2)
+					|| addressIsInSdramBanks(stream->M0AR, bank1, bank2)
+					|| addressIsInSdramBanks(stream->M1AR, bank1, bank2)) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool sdmmcTargetsSdram (const SDMMC_TypeDef* sdmmc, const bool bank1, const bool bank2)
+{
+	return ( sdmmc->IDMACTRL & SDMMC_IDMA_IDMAEN ) && ( sdmmc->STA & SDMMC_STA_DPSMACT )
+		&& ( addressIsInSdramBanks(sdmmc->IDMABASE0, bank1, bank2) || addressIsInSdramBanks(sdmmc->IDMABASE1, bank1, bank2) );
+}
+
+static bool ltdcLayerTargetsSdram (const LTDC_Layer_TypeDef* layer, const bool bank1, const bool bank2)
+{
+	return ( LTDC->GCR & LTDC_GCR_LTDCEN ) && ( layer->CR & LTDC_LxCR_LEN ) && addressIsInSdramBanks( layer->CFBAR, bank1, bank2 );
+}
+
+// only masters whose clocks are running are checked, since the registers of a peripheral with its clock gated read as zero
+bool LLPD::fmc_sdram_dma_is_active (const bool bank1, const bool bank2)
+{
+	if ( LLPD::periph_clock_is_enabled(PERIPH::DMA_1) && dmaStreamsTargetSdram(DMA1_Stream0_BASE, bank1, bank2) )
+	{
+		return true;
+	}
+
+	if ( LLPD::periph_clock_is_enabled(PERIPH::DMA_2) && dmaStreamsTargetSdram(DMA2_Stream0_BASE, bank1, bank2) )
+	{
+		return true;
+	}
+
+	if ( RCC->AHB3ENR & RCC_AHB3ENR_MDMAEN )
+	{
+		for ( uint32_t channelNum = 0; channelNum < FMC_SDRAM_NUM_MDMA_CHANNELS; channelNum++ )
+		{
+			const MDMA_Channel_TypeDef* channel = reinterpret_cast<MDMA_Channel_TypeDef*>( MDMA_Channel0_BASE
+													+ (channelNum * FMC_SDRAM_MDMA_CHANNEL_STRIDE) );
+			if ( (channel->CCR & MDMA_CCR_EN) && (addressIsInSdramBanks(channel->CSAR, bank1, bank2)
+						|| addressIsInSdramBanks(channel->CDAR, bank1, bank2)) )
+			{
+				return true;
+			}
+		}
+	}
+
+	if ( (RCC->AHB3ENR & RCC_AHB3ENR_DMA2DEN) && (DMA2D->CR & DMA2D_CR_START) && (addressIsInSdramBanks(DMA2D->FGMAR, bank1, bank2)
+				|| addressIsInSdramBanks(DMA2D->BGMAR, bank1, bank2) || addressIsInSdramBanks(DMA2D->OMAR, bank1, bank2)) )
+	{
+		return true;
+	}
+
+	if ( (LLPD::periph_clock_is_enabled(PERIPH::SDMMC_1) && sdmmcTargetsSdram(SDMMC1, bank1, bank2))
+			|| ((RCC->AHB2ENR & RCC_AHB2ENR_SDMMC2EN) && sdmmcTargetsSdram(SDMMC2, bank1, bank2)) )
+	{
+		return true;
+	}
+
+	if ( LLPD::periph_clock_is_enabled(PERIPH::LTDC_1) && (ltdcLayerTargetsSdram(LTDC_Layer1, bank1, bank2)
+								|| ltdcLayerTargetsSdram(LTDC_Layer2, bank1, bank2)) )
+	{
+		return true;
+	}
+
+	return false;
+}
+
+static bool sdramBanksAreInMode (const bool bank1, const bool bank2, const uint32_t modeStatus)
+{
+	const uint32_t sdsr = FMC_Bank5_6_R->SDSR;
+
+	return ( ! bank1 || ((sdsr & FMC_SDSR_MODES1) >> FMC_SDSR_MODES1_Pos) == modeStatus )
+		&& ( ! bank2 || ((sdsr & FMC_SDSR_MODES2) >> FMC_SDSR_MODES2_Pos) == modeStatus );
+}
+
+// issues the mode command and counts cpu cycles until the status register shows both banks in the new mode
+static bool sendSdramPowerModeCommand (const bool bank1, const bool bank2, const FMC_SDRAM_POWER_MODE& mode)
+{
+	uint32_t command = 0;
+	uint32_t modeStatus = 0;
+	switch ( mode )
+	{
+		case FMC_SDRAM_POWER_MODE::NORMAL:
+			command = 0b000;
+			modeStatus = 0b00;
+			break;
+		case FMC_SDRAM_POWER_MODE::SELF_REFRESH:
+			command = 0b101;
+			modeStatus = 0b01;
+			break;
+		case FMC_SDRAM_POWER_MODE::POWER_DOWN:
+			command = 0b110;
+			modeStatus = 0b10;
+			break;
+	}
+
+	uint32_t bankSelection = 0;
+	if ( bank1 )
+	{
+		bankSelection |= FMC_SDCMR_CTB1;
+	}
+	if ( bank2 )
+	{
+		bankSelection |= FMC_SDCMR_CTB2;
+	}
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	const uint32_t startCycles = DWT->CYCCNT;
+	FMC_Bank5_6_R->SDCMR = bankSelection | ( command << FMC_SDCMR_MODE_Pos );
+
+	while ( ! sdramBanksAreInMode(bank1, bank2, modeStatus) )
+	{
+		if ( DWT->CYCCNT - startCycles > FMC_SDRAM_MODE_TIMEOUT_CYCLES )
+		{
+			return false;
+		}
+	}
+
+	fmcSdramTransitionCycles = DWT->CYCCNT - startCycles;
+
+	return true;
+}
+
+bool LLPD::fmc_sdram_enter_low_power (const bool bank1, const bool bank2, const FMC_SDRAM_POWER_MODE& mode)
+{
+	if ( (! bank1 && ! bank2) || mode == FMC_SDRAM_POWER_MODE::NORMAL )
+	{
+		return false;
+	}
+
+	// a dma transfer into a bank in self-refresh would stall the bus matrix, so the transition is refused instead
+	if ( LLPD::fmc_sdram_dma_is_active(bank1, bank2) )
+	{
+		return false;
+	}
+
+#ifndef CORE_CM4
+	// dirty lines evicted later would wake the sdram back up, so they're written back first
+	if ( LLPD::cache_dcache_is_enabled() )
+	{
+		SCB_CleanDCache();
+	}
+#endif
+
+	return sendSdramPowerModeCommand( bank1, bank2, mode );
+}
+
+bool LLPD::fmc_sdram_exit_low_power (const bool bank1, const bool bank2)
+{
+	if ( ! bank1 && ! bank2 )
+	{
+		return false;
+	}
+
+	// the controller waits txsr after the normal mode command before letting accesses through
+	return sendSdramPowerModeCommand( bank1, bank2, FMC_SDRAM_POWER_MODE::NORMAL );
+}
+
+FMC_SDRAM_POWER_MODE LLPD::fmc_sdram_get_power_mode (const FMC_SDRAM_BANK& bank)
+{
+	const uint32_t sdsr = FMC_Bank5_6_R->SDSR;
+	const uint32_t modeStatus = ( bank == FMC_SDRAM_BANK::BANK_5 ) ? ( sdsr & FMC_SDSR_MODES1 ) >> FMC_SDSR_MODES1_Pos
+									: ( sdsr & FMC_SDSR_MODES2 ) >> FMC_SDSR_MODES2_Pos;
+
+	switch ( modeStatus )
+	{
+		case 0b01:
+			return FMC_SDRAM_POWER_MODE::SELF_REFRESH;
+		case 0b10:
+			return FMC_SDRAM_POWER_MODE::POWER_DOWN;
+		default:
+			return FMC_SDRAM_POWER_MODE::NORMAL;
+	}
+}
+
+uint32_t LLPD::fmc_sdram_get_last_transition_cycles()
+{
+	return fmcSdramTransitionCycles;
+}
@@ -2,43 +2,53 @@
 
 static inline GPIO_TypeDef* PortToPortPtr (const GPIO_PORT& port)
 {
-	switch ( port )
-	{
-		case GPIO_PORT::A:
-			return GPIOA;
-
-		case GPIO_PORT::B:
-			return GPIOB;
-
-		case GPIO_PORT::C:
-			return GPIOC;
-
-		case GPIO_PORT::D:
-			return GPIOD;
+	return reinterpret_cast<GPIO_TypeDef*>( gpio_port_address(port) );
+}
 
-		case GPIO_PORT::E:
-			return GPIOE;
+// empty callback so the dispatch never needs to check for null
+static void gpioExtiNoCallback() {}
 
-		case GPIO_PORT::F:
-			return GPIOF;
+// exti callbacks indexed by line (which is the same as the pin number)
+static void (*gpioExtiCallbacks[16])() =
+{
+	gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback,
+	gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback,
+	gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback,
+	gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback, gpioExtiNoCallback
+};
+
+// services every pending line in lineMask, finding each line with clz instead of scanning
+static inline void gpioExtiDispatch (const uint32_t lineMask)
+{
+	uint32_t pending = exti_current_core()->PR1 & lineMask;
 
-		case GPIO_PORT::G:
-			return GPIOG;
+	while ( pending )
+	{
+		const uint32_t line = 31 - __CLZ( pending );
+		const uint32_t lineBit = 1UL << line;
 
-		case GPIO_PORT::H:
-			return GPIOH;
+		// clear the pending flag before the callback so an edge during the callback isn't lost
+		exti_current_core()->PR1 = lineBit;
+		pending &= ~(lineBit);
 
-		case GPIO_PORT::I:
-			return GPIOI;
+		gpioExtiCallbacks[line]();
+	}
+}
 
-		case GPIO_PORT::J:
-			return GPIOJ;
+static inline IRQn_Type PinToExtiIRQn (const GPIO_PIN& pin)
+{
+	const unsigned int pinNum = static_cast<unsigned int>( pin );
 
-		case GPIO_PORT::K:
-			return GPIOK;
+	if ( pinNum <= 4 )
+	{
+		return static_cast<IRQn_Type>( EXTI0_IRQn + pinNum );
+	}
+	else if ( pinNum <= 9 )
+	{
+		return EXTI9_5_IRQn;
 	}
 
-	return nullptr;
+	return EXTI15_10_IRQn;
 }
 
 static inline void PinToModeBits (const GPIO_PIN& pin, uint32_t& modeBit0, uint32_t& modeBit1)
@@ -581,179 +591,125 @@ void LLPD::gpio_output_setup (const GPIO_PORT& port, const GPIO_PIN& pin, const
 
 bool LLPD::gpio_input_get (const GPIO_PORT& port, const GPIO_PIN& pin)
 {
-	GPIO_TypeDef* portPtr = PortToPortPtr( port );
-
-	if ( pin == GPIO_PIN::PIN_0 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID0;
-	}
-	else if ( pin == GPIO_PIN::PIN_1 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID1;
-	}
-	else if ( pin == GPIO_PIN::PIN_2 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID2;
-	}
-	else if ( pin == GPIO_PIN::PIN_3 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID3;
-	}
-	else if ( pin == GPIO_PIN::PIN_4 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID4;
-	}
-	else if ( pin == GPIO_PIN::PIN_5 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID5;
-	}
-	else if ( pin == GPIO_PIN::PIN_6 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID6;
-	}
-	else if ( pin == GPIO_PIN::PIN_7 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID7;
-	}
-	else if ( pin == GPIO_PIN::PIN_8 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID8;
-	}
-	else if ( pin == GPIO_PIN::PIN_9 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID9;
-	}
-	else if ( pin == GPIO_PIN::PIN_10 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID10;
-	}
-	else if ( pin == GPIO_PIN::PIN_11 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID11;
-	}
-	else if ( pin == GPIO_PIN::PIN_12 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID12;
-	}
-	else if ( pin == GPIO_PIN::PIN_13 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID13;
-	}
-	else if ( pin == GPIO_PIN::PIN_14 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID14;
-	}
-	else if ( pin == GPIO_PIN::PIN_15 )
-	{
-		return portPtr->IDR & GPIO_IDR_ID15;
-	}
-	else
-	{
-		return false;
-	}
+	return PortToPortPtr( port )->IDR & gpio_pin_mask( pin );
 }
 
 void LLPD::gpio_output_set (const GPIO_PORT& port, const GPIO_PIN& pin, bool set)
 {
-	GPIO_TypeDef* portPtr = PortToPortPtr( port );
+	const uint32_t mask = gpio_pin_mask( pin );
 
-	uint32_t setBit;
-	uint32_t resetBit;
+	// BSRR is write-only, so write the bit directly instead of read-modify-writing
+	PortToPortPtr( port )->BSRR = ( set ) ? mask : ( mask << 16 );
+}
 
-	switch ( pin )
-	{
-		case GPIO_PIN::PIN_0:
-			setBit   = GPIO_BSRR_BS0;
-			resetBit = GPIO_BSRR_BR0;
+uint16_t LLPD::gpio_port_input_get (const GPIO_PORT& port)
+{
+	return PortToPortPtr( port )->IDR;
+}
 
-			break;
-		case GPIO_PIN::PIN_1:
-			setBit   = GPIO_BSRR_BS1;
-			resetBit = GPIO_BSRR_BR1;
+void LLPD::gpio_port_output_set_mask (const GPIO_PORT& port, uint16_t setMask)
+{
+	PortToPortPtr( port )->BSRR = setMask;
+}
 
-			break;
-		case GPIO_PIN::PIN_2:
-			setBit   = GPIO_BSRR_BS2;
-			resetBit = GPIO_BSRR_BR2;
+void LLPD::gpio_port_output_clear_mask (const GPIO_PORT& port, uint16_t clearMask)
+{
+	PortToPortPtr( port )->BSRR = static_cast<uint32_t>( clearMask ) << 16;
+}
 
-			break;
-		case GPIO_PIN::PIN_3:
-			setBit   = GPIO_BSRR_BS3;
-			resetBit = GPIO_BSRR_BR3;
+void LLPD::gpio_port_output_write_mask (const GPIO_PORT& port, uint16_t setMask, uint16_t clearMask)
+{
+	PortToPortPtr( port )->BSRR = setMask | ( static_cast<uint32_t>(clearMask) << 16 );
+}
 
-			break;
-		case GPIO_PIN::PIN_4:
-			setBit   = GPIO_BSRR_BS4;
-			resetBit = GPIO_BSRR_BR4;
+void LLPD::gpio_port_output_write_range (const GPIO_PORT& port, const GPIO_PIN& firstPin, unsigned int numBits, uint16_t value)
+{
+	// ensure the range fits in the port
+	if ( numBits == 0 || static_cast<unsigned int>(firstPin) + numBits > 16 )
+	{
+		return;
+	}
 
-			break;
-		case GPIO_PIN::PIN_5:
-			setBit   = GPIO_BSRR_BS5;
-			resetBit = GPIO_BSRR_BR5;
+	PortToPortPtr( port )->BSRR = gpio_range_bsrr_value( firstPin, numBits, value );
+}
 
-			break;
-		case GPIO_PIN::PIN_6:
-			setBit   = GPIO_BSRR_BS6;
-			resetBit = GPIO_BSRR_BR6;
+void LLPD::gpio_interrupt_setup (const GPIO_PORT& port, const GPIO_PIN& pin, const GPIO_EXTI_EDGE& edge, void (*callback)(),
+					uint8_t priority)
+{
+	const unsigned int pinNum = static_cast<unsigned int>( pin );
+	const uint32_t lineBit = gpio_pin_mask( pin );
 
-			break;
-		case GPIO_PIN::PIN_7:
-			setBit   = GPIO_BSRR_BS7;
-			resetBit = GPIO_BSRR_BR7;
+	// mask the line while it's being configured
+	exti_current_core()->IMR1 &= ~(lineBit);
 
-			break;
-		case GPIO_PIN::PIN_8:
-			setBit   = GPIO_BSRR_BS8;
-			resetBit = GPIO_BSRR_BR8;
+	gpioExtiCallbacks[pinNum] = ( callback ) ? callback : gpioExtiNoCallback;
 
-			break;
-		case GPIO_PIN::PIN_9:
-			setBit   = GPIO_BSRR_BS9;
-			resetBit = GPIO_BSRR_BR9;
+	// enable syscfg clock
+	LLPD::periph_enable_clock( PERIPH::SYS_CFG );
 
-			break;
-		case GPIO_PIN::PIN_10:
-			setBit   = GPIO_BSRR_BS10;
-			resetBit = GPIO_BSRR_BR10;
+	// route the port to the exti line (4 lines per EXTICR register, 4 bits per line)
+	const unsigned int exticrShift = ( pinNum % 4 ) * 4;
+	SYSCFG->EXTICR[pinNum / 4] &= ~(0b1111 << exticrShift);
+	SYSCFG->EXTICR[pinNum / 4] |= ( static_cast<uint32_t>(port) << exticrShift );
 
-			break;
-		case GPIO_PIN::PIN_11:
-			setBit   = GPIO_BSRR_BS11;
-			resetBit = GPIO_BSRR_BR11;
+	// set edge selection
+	if ( edge == GPIO_EXTI_EDGE::RISING || edge == GPIO_EXTI_EDGE::BOTH )
+	{
+		EXTI->RTSR1 |= lineBit;
+	}
+	else
+	{
+		EXTI->RTSR1 &= ~(lineBit);
+	}
 
-			break;
-		case GPIO_PIN::PIN_12:
-			setBit   = GPIO_BSRR_BS12;
-			resetBit = GPIO_BSRR_BR12;
+	if ( edge == GPIO_EXTI_EDGE::FALLING || edge == GPIO_EXTI_EDGE::BOTH )
+	{
+		EXTI->FTSR1 |= lineBit;
+	}
+	else
+	{
+		EXTI->FTSR1 &= ~(lineBit);
+	}
 
-			break;
-		case GPIO_PIN::PIN_13:
-			setBit   = GPIO_BSRR_BS13;
-			resetBit = GPIO_BSRR_BR13;
+	// clear any stale pending flag
+	exti_current_core()->PR1 = lineBit;
 
-			break;
-		case GPIO_PIN::PIN_14:
-			setBit   = GPIO_BSRR_BS14;
-			resetBit = GPIO_BSRR_BR14;
+	// set priority and enable irq (shared irqs keep whatever priority was set last)
+	const IRQn_Type irq = PinToExtiIRQn( pin );
+	NVIC_SetPriority( irq, priority );
+	NVIC_EnableIRQ( irq );
 
-			break;
-		case GPIO_PIN::PIN_15:
-			setBit   = GPIO_BSRR_BS15;
-			resetBit = GPIO_BSRR_BR15;
+	// unmask the line
+	exti_current_core()->IMR1 |= lineBit;
+}
 
-			break;
-		default:
-			return;
-	}
+void LLPD::gpio_interrupt_enable (const GPIO_PIN& pin)
+{
+	exti_current_core()->IMR1 |= gpio_pin_mask( pin );
+}
 
-	if ( set )
-	{
-		portPtr->BSRR |= setBit;
-	}
-	else
+void LLPD::gpio_interrupt_disable (const GPIO_PIN& pin)
+{
+	exti_current_core()->IMR1 &= ~(gpio_pin_mask( pin ));
+}
+
+void LLPD::gpio_apply_port_image (const GPIO_PORT& port, const GPIO_PORT_IMAGE& image)
+{
+	GPIO_TypeDef* portPtr = PortToPortPtr( port );
+
+	// everything except the mode is applied first, so pins never switch mode with a stale alternate function or level
+	portPtr->AFR[0]  = ( portPtr->AFR[0]  & ~(image.afrMask[0])  ) | image.afr[0];
+	portPtr->AFR[1]  = ( portPtr->AFR[1]  & ~(image.afrMask[1])  ) | image.afr[1];
+	portPtr->OTYPER  = ( portPtr->OTYPER  & ~(image.otyperMask)  ) | image.otyper;
+	portPtr->OSPEEDR = ( portPtr->OSPEEDR & ~(image.ospeedrMask) ) | image.ospeedr;
+	portPtr->PUPDR   = ( portPtr->PUPDR   & ~(image.pupdrMask)   ) | image.pupdr;
+
+	if ( image.bsrr != 0 )
 	{
-		portPtr->BSRR |= resetBit;
+		portPtr->BSRR = image.bsrr;
 	}
+
+	portPtr->MODER   = ( portPtr->MODER   & ~(image.moderMask)   ) | image.moder;
 }
 
 void LLPD::gpio_test()
@@ -0,0 +1,221 @@
+#include "LLPD.hpp"
+
+// the gpio benchmark compares gpio_output_set and Pin<> against the switch based gpio_output_set they replaced, which is only
+// kept here as the reference
+
+static GPIO_TypeDef* gpioBenchSwitchPortPtr (const GPIO_PORT& port)
+{
+	switch ( port )
+	{
+		case GPIO_PORT::A:
+			return GPIOA;
+
+		case GPIO_PORT::B:
+			return GPIOB;
+
+		case GPIO_PORT::C:
+			return GPIOC;
+
+		case GPIO_PORT::D:
+			return GPIOD;
+
+		case GPIO_PORT::E:
+			return GPIOE;
+
+		case GPIO_PORT::F:
+			return GPIOF;
+
+		case GPIO_PORT::G:
+			return GPIOG;
+
+		case GPIO_PORT::H:
+			return GPIOH;
+
+		case GPIO_PORT::I:
+			return GPIOI;
+
+		case GPIO_PORT::J:
+			return GPIOJ;
+
+		case GPIO_PORT::K:
+			return GPIOK;
+	}
+
+	return nullptr;
+}
+
+static void __attribute__(( noinline )) gpioBenchSwitchOutputSet (const GPIO_PORT& port, const GPIO_PIN& pin, bool set)
+{
+	GPIO_TypeDef* portPtr = gpioBenchSwitchPortPtr( port );
+
+	uint32_t setBit;
+	uint32_t resetBit;
+
+	switch ( pin )
+	{
+		case GPIO_PIN::PIN_0:
+			setBit   = GPIO_BSRR_BS0;
+			resetBit = GPIO_BSRR_BR0;
+
+			break;
+		case GPIO_PIN::PIN_1:
+			setBit   = GPIO_BSRR_BS1;
+			resetBit = GPIO_BSRR_BR1;
+
+			break;
+		case GPIO_PIN::PIN_2:
+			setBit   = GPIO_BSRR_BS2;
+			resetBit = GPIO_BSRR_BR2;
+
+			break;
+		case GPIO_PIN::PIN_3:
+			setBit   = GPIO_BSRR_BS3;
+			resetBit = GPIO_BSRR_BR3;
+
+			break;
+		case GPIO_PIN::PIN_4:
+			setBit   = GPIO_BSRR_BS4;
+			resetBit = GPIO_BSRR_BR4;
+
+			break;
+		case GPIO_PIN::PIN_5:
+			setBit   = GPIO_BSRR_BS5;
+			resetBit = GPIO_BSRR_BR5;
+
+			break;
+		case GPIO_PIN::PIN_6:
+			setBit   = GPIO_BSRR_BS6;
+			resetBit = GPIO_BSRR_BR6;
+
+			break;
+		case GPIO_PIN::PIN_7:
+			setBit   = GPIO_BSRR_BS7;
+			resetBit = GPIO_BSRR_BR7;
+
+			break;
+		case GPIO_PIN::PIN_8:
+			setBit   = GPIO_BSRR_BS8;
+			resetBit = GPIO_BSRR_BR8;
+
+			break;
+		case GPIO_PIN::PIN_9:
+			setBit   = GPIO_BSRR_BS9;
+			resetBit = GPIO_BSRR_BR9;
+
+			break;
+		case GPIO_PIN::PIN_10:
+			setBit   = GPIO_BSRR_BS10;
+			resetBit = GPIO_BSRR_BR10;
+
+			break;
+		case GPIO_PIN::PIN_11:
+			setBit   = GPIO_BSRR_BS11;
+			resetBit = GPIO_BSRR_BR11;
+
+			break;
+		case GPIO_PIN::PIN_12:
+			setBit   = GPIO_BSRR_BS12;
+			resetBit = GPIO_BSRR_BR12;
+
+			break;
+		case GPIO_PIN::PIN_13:
+			setBit   = GPIO_BSRR_BS13;
+			resetBit = GPIO_BSRR_BR13;
+
+			break;
+		case GPIO_PIN::PIN_14:
+			setBit   = GPIO_BSRR_BS14;
+			resetBit = GPIO_BSRR_BR14;
+
+			break;
+		case GPIO_PIN::PIN_15:
+			setBit   = GPIO_BSRR_BS15;
+			resetBit = GPIO_BSRR_BR15;
+
+			break;
+		default:
+			return;
+	}
+
+	if ( set )
+	{
+		portPtr->BSRR |= setBit;
+	}
+	else
+	{
+		portPtr->BSRR |= resetBit;
+	}
+}
+
+static uint32_t gpioBenchSwitchOutputSetCycles (const GPIO_PORT& port, const GPIO_PIN& pin, const uint32_t numLoops)
+{
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	for ( uint32_t loop = 0; loop < numLoops; loop++ )
+	{
+		for ( uint32_t write = 0; write < GPIO_BENCH_WRITES_PER_LOOP; write += 2 )
+		{
+			gpioBenchSwitchOutputSet( port, pin, true );
+			gpioBenchSwitchOutputSet( port, pin, false );
+		}
+	}
+
+	return DWT->CYCCNT - startCycles;
+}
+
+static uint32_t gpioBenchOutputSetCycles (const GPIO_PORT& port, const GPIO_PIN& pin, const uint32_t numLoops)
+{
+	// called through a pointer so it can't be inlined here, since callers in other translation units always pay for the call
+	void (* volatile outputSetVolatile)(const GPIO_PORT&, const GPIO_PIN&, bool) = &LLPD::gpio_output_set;
+	void (* const outputSet)(const GPIO_PORT&, const GPIO_PIN&, bool) = outputSetVolatile;
+
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	for ( uint32_t loop = 0; loop < numLoops; loop++ )
+	{
+		for ( uint32_t write = 0; write < GPIO_BENCH_WRITES_PER_LOOP; write += 2 )
+		{
+			outputSet( port, pin, true );
+			outputSet( port, pin, false );
+		}
+	}
+
+	return DWT->CYCCNT - startCycles;
+}
+
+GPIO_BENCH_RESULT LLPD::gpio_bench_run (const GPIO_PORT& port, const GPIO_PIN& pin, uint32_t (*pinWriteCycles)(uint32_t numLoops))
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	// the first pass warms up the caches and the flash accelerator, so the numbers are steady state
+	gpioBenchSwitchOutputSetCycles( port, pin, 1 );
+	gpioBenchOutputSetCycles( port, pin, 1 );
+	pinWriteCycles( 1 );
+
+	const uint32_t numLoops = GPIO_BENCH_NUM_WRITES / GPIO_BENCH_WRITES_PER_LOOP;
+
+	GPIO_BENCH_RESULT result;
+	result.switchOutputSetCycles = static_cast<float>( gpioBenchSwitchOutputSetCycles(port, pin, numLoops) ) / GPIO_BENCH_NUM_WRITES;
+	result.outputSetCycles = static_cast<float>( gpioBenchOutputSetCycles(port, pin, numLoops) ) / GPIO_BENCH_NUM_WRITES;
+	result.pinWriteCycles = static_cast<float>( pinWriteCycles(numLoops) ) / GPIO_BENCH_NUM_WRITES;
+
+	__set_PRIMASK( primask );
+
+	return result;
+}
+
+void LLPD::gpio_bench_log (const USART_NUM& usartNum, const GPIO_BENCH_RESULT& result)
+{
+#ifdef CORE_CM4
+	LLPD::usart_log( usartNum, "cpu2 gpio write cycles" );
+#else
+	LLPD::usart_log( usartNum, "cpu1 gpio write cycles" );
+#endif
+	LLPD::usart_log_float( usartNum, "    switch based gpio_output_set: ", result.switchOutputSetCycles );
+	LLPD::usart_log_float( usartNum, "    gpio_output_set: ", result.outputSetCycles );
+	LLPD::usart_log_float( usartNum, "    Pin<>::write: ", result.pinWriteCycles );
+}
@@ -0,0 +1,139 @@
+#include "LLPD.hpp"
+
+// per-port debounce state, using a 2-bit vertical counter so all 16 pins of a port are debounced with a handful of bitwise ops
+struct GpioDebouncePort
+{
+	uint16_t pinMask = 0; 		// pins being debounced on this port
+	uint16_t activeLowMask = 0; 	// pins that read low when pressed
+	uint16_t state = 0; 		// debounced pin levels
+	uint16_t count0 = 0; 		// vertical counter bit 0
+	uint16_t count1 = 0; 		// vertical counter bit 1
+};
+
+static constexpr unsigned int GPIO_NUM_PORTS = static_cast<unsigned int>( GPIO_PORT::K ) + 1;
+LLPD_DTCM_BSS static GpioDebouncePort gpioDebouncePorts[GPIO_NUM_PORTS];
+static volatile uint16_t gpioDebounceActivePorts = 0; // one bit per port with at least one pin being debounced
+
+// single producer (the timer isr) single consumer (the main loop) event queue, size needs to be a power of 2
+static constexpr unsigned int GPIO_DEBOUNCE_QUEUE_SIZE = 32;
+LLPD_DTCM_BSS static GPIO_DEBOUNCE_EVENT gpioDebounceQueue[GPIO_DEBOUNCE_QUEUE_SIZE];
+static volatile uint32_t gpioDebounceQueueWriteIndex = 0;
+static volatile uint32_t gpioDebounceQueueReadIndex = 0;
+static volatile uint32_t gpioDebounceNumDroppedEvents = 0;
+
+static inline void gpioDebouncePushEvent (const GPIO_PORT& port, const GPIO_PIN& pin, const bool pressed)
+{
+	const uint32_t writeIndex = gpioDebounceQueueWriteIndex;
+	if ( writeIndex - gpioDebounceQueueReadIndex >= GPIO_DEBOUNCE_QUEUE_SIZE )
+	{
+		// queue is full, so drop the event rather than overwrite one the main loop hasn't read yet
+		gpioDebounceNumDroppedEvents = gpioDebounceNumDroppedEvents + 1;
+
+		return;
+	}
+
+	GPIO_DEBOUNCE_EVENT& event = gpioDebounceQueue[writeIndex & (GPIO_DEBOUNCE_QUEUE_SIZE - 1)];
+	event.port = port;
+	event.pin = pin;
+	event.pressed = pressed;
+
+	// ensure the event is written before it's published
+	__DMB();
+
+	gpioDebounceQueueWriteIndex = writeIndex + 1;
+}
+
+void LLPD::gpio_debounce_add_pin (const GPIO_PORT& port, const GPIO_PIN& pin, bool activeLow)
+{
+	const unsigned int portNum = static_cast<unsigned int>( port );
+	const uint16_t mask = gpio_pin_mask( pin );
+	GpioDebouncePort& debouncePort = gpioDebouncePorts[portNum];
+
+	// stop the isr from scanning this port while it's being changed
+	gpioDebounceActivePorts &= ~(1 << portNum);
+
+	debouncePort.pinMask |= mask;
+
+	if ( activeLow )
+	{
+		debouncePort.activeLowMask |= mask;
+	}
+	else
+	{
+		debouncePort.activeLowMask &= ~(mask);
+	}
+
+	// start from the current level so there's no event at startup
+	debouncePort.state = ( debouncePort.state & ~(mask) ) | ( LLPD::gpio_port_input_get(port) & mask );
+	debouncePort.count0 &= ~(mask);
+	debouncePort.count1 &= ~(mask);
+
+	gpioDebounceActivePorts |= ( 1 << portNum );
+}
+
+LLPD_ITCM_FUNC void LLPD::gpio_debounce_isr_sample()
+{
+	uint32_t activePorts = gpioDebounceActivePorts;
+
+	while ( activePorts )
+	{
+		const unsigned int portNum = 31 - __CLZ( activePorts );
+		activePorts &= ~(1UL << portNum);
+
+		GpioDebouncePort& debouncePort = gpioDebouncePorts[portNum];
+		const GPIO_PORT port = static_cast<GPIO_PORT>( portNum );
+
+		// one read for the whole port
+		const uint16_t sample = LLPD::gpio_port_input_get( port ) & debouncePort.pinMask;
+
+		// vertical counter: the count of a pin is reset whenever it matches the debounced state,
+		// and the debounced state toggles once the pin has differed from it for 4 consecutive samples
+		const uint16_t delta = sample ^ debouncePort.state;
+		debouncePort.count1 = ( debouncePort.count1 ^ debouncePort.count0 ) & delta;
+		debouncePort.count0 = ~(debouncePort.count0) & delta;
+		uint32_t toggled = delta & ~( debouncePort.count0 | debouncePort.count1 );
+		debouncePort.state ^= toggled;
+
+		const uint16_t pressed = debouncePort.state ^ debouncePort.activeLowMask;
+		while ( toggled )
+		{
+			const unsigned int pinNum = 31 - __CLZ( toggled );
+			toggled &= ~(1UL << pinNum);
+
+			gpioDebouncePushEvent( port, static_cast<GPIO_PIN>(pinNum), pressed & (1 << pinNum) );
+		}
+	}
+}
+
+bool LLPD::gpio_debounce_get_event (GPIO_DEBOUNCE_EVENT& event)
+{
+	const uint32_t readIndex = gpioDebounceQueueReadIndex;
+	if ( readIndex == gpioDebounceQueueWriteIndex )
+	{
+		return false;
+	}
+
+	// ensure the event is read after its index was published
+	__DMB();
+
+	event = gpioDebounceQueue[readIndex & (GPIO_DEBOUNCE_QUEUE_SIZE - 1)];
+
+	// ensure the event is copied out before the slot is handed back to the isr
+	__DMB();
+
+	gpioDebounceQueueReadIndex = readIndex + 1;
+
+	return true;
+}
+
+bool LLPD::gpio_debounce_is_pressed (const GPIO_PORT& port, const GPIO_PIN& pin)
+{
+	const GpioDebouncePort& debouncePort = gpioDebouncePorts[static_cast<unsigned int>( port )];
+
+	return ( debouncePort.state ^ debouncePort.activeLowMask ) & gpio_pin_mask( pin );
+}
+
+unsigned int LLPD::gpio_debounce_get_num_dropped_events()
+{
+	return gpioDebounceNumDroppedEvents;
+}
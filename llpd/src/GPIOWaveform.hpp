@@ -0,0 +1,168 @@
+#include "LLPD.hpp"
+
+// the waveform engine uses tim7 update events to pace dma2 stream 0, which copies one word per event into the port's BSRR
+
+static GPIO_TypeDef* gpioWaveformPortPtr = nullptr;
+
+void LLPD::gpio_waveform_init (const GPIO_PORT& port, uint32_t prescalerDivisor, uint32_t cyclesPerWord)
+{
+	// the timer updates every ARR + 1 counts, so there must be at least one count per word
+	if ( cyclesPerWord == 0 )
+	{
+		return;
+	}
+
+	gpioWaveformPortPtr = reinterpret_cast<GPIO_TypeDef*>( gpio_port_address(port) );
+
+	// make sure nothing is running during setup
+	LLPD::gpio_waveform_stop();
+
+	// enable peripheral clock to TIM7
+	LLPD::periph_enable_clock( PERIPH::TIM_7 );
+
+	// reset registers
+	LLPD::periph_reset( PERIPH::TIM_7 );
+
+	// set timer prescaler and auto-reload values
+	TIM7->PSC = prescalerDivisor;
+	TIM7->ARR = cyclesPerWord - 1;
+
+	// send an update event to apply the settings
+	TIM7->EGR |= TIM_EGR_UG;
+
+	// clear update status
+	TIM7->SR = 0;
+
+	// request a dma transfer on each update event
+	TIM7->DIER |= TIM_DIER_UDE;
+
+	// enable syscfg clock for DMA
+	LLPD::periph_enable_clock( PERIPH::SYS_CFG );
+
+	// enable dma2 clock
+	LLPD::periph_enable_clock( PERIPH::DMA_2 );
+
+	// set peripheral address for stream
+	DMA2_Stream0->PAR = (uint64_t) &(gpioWaveformPortPtr->BSRR);
+
+	// set up dma request input (dma2 stream 0 is dmamux1 channel 8)
+	DMAMUX1_Channel8->CCR = periph_desc( PERIPH::TIM_7 ).dmaReqTx;
+}
+
+void LLPD::gpio_waveform_start (const uint32_t* bsrrWords, uint16_t numWords, bool circular)
+{
+	if ( gpioWaveformPortPtr == nullptr || numWords == 0 )
+	{
+		return;
+	}
+
+	LLPD::gpio_waveform_stop();
+
+	// write the buffer back to memory so the dma sees the encoded words
+	LLPD::cache_clean_range( bsrrWords, numWords * sizeof(uint32_t) );
+
+	// set the memory address for where the bsrr words will be coming from
+	DMA2_Stream0->M0AR = (uint64_t) bsrrWords;
+
+	// configure the number of data to be transferred
+	DMA2_Stream0->NDTR = numWords;
+
+	// set data transfer direction from memory to peripheral
+	DMA2_Stream0->CR &= ~(DMA_SxCR_DIR);
+	DMA2_Stream0->CR |= DMA_SxCR_DIR_0;
+
+	// set the peripheral and memory data sizes to 32 bits
+	DMA2_Stream0->CR &= ~(DMA_SxCR_PSIZE);
+	DMA2_Stream0->CR |= DMA_SxCR_PSIZE_1;
+	DMA2_Stream0->CR &= ~(DMA_SxCR_MSIZE);
+	DMA2_Stream0->CR |= DMA_SxCR_MSIZE_1;
+
+	// enable memory incrementing
+	DMA2_Stream0->CR |= DMA_SxCR_MINC;
+
+	// set circular mode if requested, so the waveform repeats until stopped
+	if ( circular )
+	{
+		DMA2_Stream0->CR |= DMA_SxCR_CIRC;
+	}
+
+	// configure stream priority to very high, since a late transfer shows up as jitter on the pins
+	DMA2_Stream0->CR |= DMA_SxCR_PL;
+
+	// set direct mode
+	DMA2_Stream0->FCR &= ~(DMA_SxFCR_DMDIS);
+
+	// clear flags before enabling
+	DMA2->LIFCR |= DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+
+	// enable stream
+	DMA2_Stream0->CR |= DMA_SxCR_EN;
+
+	// start the timer, the first word is written on the first update event
+	TIM7->CNT = 0;
+	TIM7->CR1 |= TIM_CR1_CEN;
+}
+
+void LLPD::gpio_waveform_stop()
+{
+	// stop the timer so no further requests are made
+	TIM7->CR1 &= ~(TIM_CR1_CEN);
+
+	// ensure dma stream is disabled and control register is reset
+	DMA2_Stream0->CR = 0;
+	while ( DMA2_Stream0->CR & DMA_SxCR_EN ) {}
+}
+
+bool LLPD::gpio_waveform_is_busy()
+{
+	return DMA2_Stream0->CR & DMA_SxCR_EN;
+}
+
+unsigned int LLPD::gpio_waveform_encode_serial (const GPIO_PIN& dataPin, const uint8_t* bytes, unsigned int numBytes, uint32_t* bsrrWords)
+{
+	const uint32_t setWord = gpio_pin_mask( dataPin );
+	const uint32_t resetWord = setWord << 16;
+
+	unsigned int numWords = 0;
+	for ( unsigned int byteNum = 0; byteNum < numBytes; byteNum++ )
+	{
+		for ( int bitNum = 7; bitNum >= 0; bitNum-- )
+		{
+			bsrrWords[numWords++] = ( bytes[byteNum] & (1 << bitNum) ) ? setWord : resetWord;
+		}
+	}
+
+	return numWords;
+}
+
+unsigned int LLPD::gpio_waveform_encode_serial_clocked (const GPIO_PIN& dataPin, const GPIO_PIN& clockPin, const uint8_t* bytes,
+								unsigned int numBytes, uint32_t* bsrrWords)
+{
+	const uint32_t dataSet = gpio_pin_mask( dataPin );
+	const uint32_t dataReset = dataSet << 16;
+	const uint32_t clockSet = gpio_pin_mask( clockPin );
+	const uint32_t clockReset = clockSet << 16;
+
+	unsigned int numWords = 0;
+	for ( unsigned int byteNum = 0; byteNum < numBytes; byteNum++ )
+	{
+		for ( int bitNum = 7; bitNum >= 0; bitNum-- )
+		{
+			// put the data out with the clock low, then raise the clock with the data held
+			bsrrWords[numWords++] = ( (bytes[byteNum] & (1 << bitNum)) ? dataSet : dataReset ) | clockReset;
+			bsrrWords[numWords++] = clockSet;
+		}
+	}
+
+	return numWords;
+}
+
+unsigned int LLPD::gpio_waveform_encode_parallel (const GPIO_PIN& firstPin, const uint8_t* bytes, unsigned int numBytes, uint32_t* bsrrWords)
+{
+	for ( unsigned int byteNum = 0; byteNum < numBytes; byteNum++ )
+	{
+		bsrrWords[byteNum] = gpio_range_bsrr_value( firstPin, 8, bytes[byteNum] );
+	}
+
+	return numBytes;
+}
@@ -2,11 +2,14 @@
 
 #include <cstdarg>
 
-static void setI2CRegisters (I2C_TypeDef* i2cPtr, uint32_t timingRegVal, uint32_t resetBits)
+static void setI2CRegisters (const PERIPH& periph, I2C_TypeDef* i2cPtr, uint32_t timingRegVal)
 {
 	// disable i2c peripheral
 	i2cPtr->CR1 &= ~(I2C_CR1_PE);
 
+	// reset registers
+	LLPD::periph_reset( periph );
+
 	// set the i2c timing register
 	i2cPtr->TIMINGR = (uint32_t)timingRegVal;
 
@@ -17,8 +20,6 @@ static void setI2CRegisters (I2C_TypeDef* i2cPtr, uint32_t timingRegVal, uint32_
 void LLPD::i2c_master_setup (const I2C_NUM& i2cNum, uint32_t timingRegVal)
 {
 	I2C_TypeDef* i2cPtr = nullptr;
-	uint32_t rccI2CEnableBits = 0;
-	uint32_t rccI2CResetBits = 0;
 
 	GPIO_TypeDef* gpioPtrScl = nullptr;
 	GPIO_TypeDef* gpioPtrSda = nullptr;
@@ -34,9 +35,6 @@ void LLPD::i2c_master_setup (const I2C_NUM& i2cNum, uint32_t timingRegVal)
 
 	if ( i2cNum == I2C_NUM::I2C_1 )
 	{
-		rccI2CEnableBits = RCC_APB1LENR_I2C1EN;
-		rccI2CResetBits = RCC_APB1LRSTR_I2C1RST;
-
 		i2cPtr = I2C1;
 
 		gpioPtrScl = GPIOB;
@@ -53,9 +51,6 @@ void LLPD::i2c_master_setup (const I2C_NUM& i2cNum, uint32_t timingRegVal)
 	}
 	else if ( i2cNum == I2C_NUM::I2C_2 )
 	{
-		rccI2CEnableBits = RCC_APB1LENR_I2C2EN;
-		rccI2CResetBits = RCC_APB1LRSTR_I2C2RST;
-
 		i2cPtr = I2C2;
 
 		gpioPtrScl = GPIOB;
@@ -72,9 +67,6 @@ void LLPD::i2c_master_setup (const I2C_NUM& i2cNum, uint32_t timingRegVal)
 	}
 	else if ( i2cNum == I2C_NUM::I2C_3 )
 	{
-		rccI2CEnableBits = RCC_APB1LENR_I2C3EN;
-		rccI2CResetBits = RCC_APB1LRSTR_I2C3RST;
-
 		i2cPtr = I2C3;
 
 		gpioPtrScl = GPIOA;
@@ -91,9 +83,6 @@ void LLPD::i2c_master_setup (const I2C_NUM& i2cNum, uint32_t timingRegVal)
 	}
 	else if ( i2cNum == I2C_NUM::I2C_4 )
 	{
-		rccI2CEnableBits = RCC_APB4ENR_I2C4EN;
-		rccI2CResetBits = RCC_APB4RSTR_I2C4RST;
-
 		i2cPtr = I2C4;
 
 		gpioPtrScl = GPIOF;
@@ -122,16 +111,9 @@ void LLPD::i2c_master_setup (const I2C_NUM& i2cNum, uint32_t timingRegVal)
 					GPIO_OUTPUT_SPEED::HIGH, true );
 
 	// enable i2c peripheral clock
-	if ( i2cNum == I2C_NUM::I2C_4 )
-	{
-		RCC->APB4ENR |= rccI2CEnableBits;
-	}
-	else
-	{
-		RCC->APB1LENR |= rccI2CEnableBits;
-	}
+	LLPD::periph_enable_clock( periph_from_i2c(i2cNum) );
 
-	setI2CRegisters( i2cPtr, timingRegVal, rccI2CResetBits );
+	setI2CRegisters( periph_from_i2c(i2cNum), i2cPtr, timingRegVal );
 }
 
 static I2C_TypeDef* getI2CPointer (const I2C_NUM& i2cNum)
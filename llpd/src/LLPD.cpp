@@ -23,8 +23,17 @@ void LLPD::setup_alt_func_pin (GPIO_TypeDef* gpioPtr, int pinNum, const int afVa
 	}
 }
 
+#include "Periph.hpp"
+#include "Cache.hpp"
+#include "MPU.hpp"
+#include "SRAM.hpp"
+#include "MemBench.hpp"
 #include "GPIO.hpp"
+#include "GPIOBench.hpp"
+#include "GPIOWaveform.hpp"
+#include "GPIODebounce.hpp"
 #include "RCC.hpp"
+#include "Power.hpp"
 #include "DAC.hpp"
 #include "ADC.hpp"
 #include "Timers.hpp"
@@ -33,6 +42,8 @@ void LLPD::setup_alt_func_pin (GPIO_TypeDef* gpioPtr, int pinNum, const int afVa
 #include "USART.hpp"
 #include "OpAmp.hpp"
 #include "FMC.hpp"
+#include "SDRAMArena.hpp"
+#include "SDRAMTest.hpp"
 #include "SDMMC.hpp"
 #include "LTDC.hpp"
 #include "HSEM.hpp"
@@ -44,8 +55,79 @@ extern "C" void Custom_Reset_Handler(void)
 	LLPD::dac_dma_stop();
 }
 
+// gpio exti handling (lines 5-9 and 10-15 share an irq, so those are dispatched by pending bit)
+extern "C" void EXTI0_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR0 );
+}
+
+extern "C" void EXTI1_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR1 );
+}
+
+extern "C" void EXTI2_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR2 );
+}
+
+extern "C" void EXTI3_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR3 );
+}
+
+extern "C" void EXTI4_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR4 );
+}
+
+extern "C" void EXTI9_5_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR5 | EXTI_PR1_PR6 | EXTI_PR1_PR7 | EXTI_PR1_PR8 | EXTI_PR1_PR9 );
+}
+
+extern "C" void EXTI15_10_IRQHandler (void)
+{
+	gpioExtiDispatch( EXTI_PR1_PR10 | EXTI_PR1_PR11 | EXTI_PR1_PR12 | EXTI_PR1_PR13 | EXTI_PR1_PR14 | EXTI_PR1_PR15 );
+}
+
+// adc continuous mode, the callbacks are called as the dma finishes each half of the buffer
+extern "C" void DMA1_Stream0_IRQHandler (void)
+{
+	const uint32_t flags = DMA1->LISR;
+
+	if ( flags & DMA_LISR_HTIF0 )
+	{
+		DMA1->LIFCR = DMA_LIFCR_CHTIF0;
+		adcContinuousHalfFilled( ADC_NUM::ADC_1_2, true );
+	}
+
+	if ( flags & DMA_LISR_TCIF0 )
+	{
+		DMA1->LIFCR = DMA_LIFCR_CTCIF0;
+		adcContinuousHalfFilled( ADC_NUM::ADC_1_2, false );
+	}
+}
+
+extern "C" void BDMA_Channel0_IRQHandler (void)
+{
+	const uint32_t flags = BDMA->ISR;
+
+	if ( flags & BDMA_ISR_HTIF0 )
+	{
+		BDMA->IFCR = BDMA_IFCR_CHTIF0;
+		adcContinuousHalfFilled( ADC_NUM::ADC_3, true );
+	}
+
+	if ( flags & BDMA_ISR_TCIF0 )
+	{
+		BDMA->IFCR = BDMA_IFCR_CTCIF0;
+		adcContinuousHalfFilled( ADC_NUM::ADC_3, false );
+	}
+}
+
 // sdmmc1 dma handling
-extern "C" void SDMMC1_IRQHandler (void)
+extern "C" LLPD_ITCM_FUNC void SDMMC1_IRQHandler (void)
 {
 	if ( SDMMC1->STA & SDMMC_STA_DATAEND )
 	{
@@ -80,6 +162,13 @@ extern "C" void SDMMC1_IRQHandler (void)
 			SDMMC1->CMD &= ~(SDMMC_CMD_CMDSTOP);
 		}
 
+		// drop any lines speculatively loaded from the read buffer during the transfer
+		if ( sdmmcReadDmaBuffer != nullptr )
+		{
+			LLPD::cache_invalidate_range( sdmmcReadDmaBuffer, sdmmcReadDmaNumBytes );
+			sdmmcReadDmaBuffer = nullptr;
+		}
+
 		sdmmcTransferCompleted = true;
 		sdmmcMultiBlockTransfer = false;
 	}
@@ -94,6 +183,7 @@ extern "C" void SDMMC1_IRQHandler (void)
 		SDMMC1->MASK &= ~( SDMMC_MASK_DCRCFAILIE | SDMMC_MASK_DTIMEOUTIE | SDMMC_MASK_TXUNDERRIE | SDMMC_MASK_DATAENDIE
 					| SDMMC_MASK_RXOVERRIE );
 
+		sdmmcReadDmaBuffer = nullptr;
 		sdmmcTransferCompleted = true;
 		sdmmcMultiBlockTransfer = false;
 	}
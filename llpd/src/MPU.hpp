@@ -0,0 +1,111 @@
+#include "LLPD.hpp"
+
+static constexpr uint32_t MPU_MIN_REGION_SIZE = 32;
+static constexpr uint32_t MPU_MIN_SUBREGION_REGION_SIZE = 256;
+
+static uint32_t getMpuAccessAttributes (const MPU_MEMORY_TYPE& memoryType)
+{
+	switch ( memoryType )
+	{
+		case MPU_MEMORY_TYPE::CACHEABLE_WRITE_BACK:
+			return ARM_MPU_ACCESS_NORMAL( ARM_MPU_CACHEP_WB_WRA, ARM_MPU_CACHEP_WB_WRA, 0 );
+		case MPU_MEMORY_TYPE::CACHEABLE_WRITE_THROUGH:
+			return ARM_MPU_ACCESS_NORMAL( ARM_MPU_CACHEP_WT_NWA, ARM_MPU_CACHEP_WT_NWA, 0 );
+		case MPU_MEMORY_TYPE::NON_CACHEABLE:
+			return ARM_MPU_ACCESS_NORMAL( ARM_MPU_CACHEP_NOCACHE, ARM_MPU_CACHEP_NOCACHE, 1 );
+		case MPU_MEMORY_TYPE::DEVICE:
+			return ARM_MPU_ACCESS_DEVICE( 1 );
+	}
+
+	return ARM_MPU_ACCESS_ORDERED;
+}
+
+// the rasr size field is log2( size ) - 1
+static uint32_t getMpuSizeField (uint32_t sizeInBytes)
+{
+	uint32_t sizeField = 0;
+	while ( sizeInBytes > 2 )
+	{
+		sizeInBytes >>= 1;
+		sizeField++;
+	}
+
+	return sizeField;
+}
+
+bool LLPD::mpu_configure_region (const MPU_REGION_CONFIG& config)
+{
+	const bool sizeIsPowerOfTwo = ( config.sizeInBytes & (config.sizeInBytes - 1) ) == 0;
+	if ( config.regionNum >= LLPD::mpu_get_num_regions() || config.sizeInBytes < MPU_MIN_REGION_SIZE || ! sizeIsPowerOfTwo
+			|| (config.baseAddress & (config.sizeInBytes - 1)) != 0
+			|| (config.subregionDisableMask != 0 && config.sizeInBytes < MPU_MIN_SUBREGION_REGION_SIZE) )
+	{
+		return false;
+	}
+
+	const uint32_t rasr = ARM_MPU_RASR_EX( config.executeNever ? 1 : 0, config.readOnly ? ARM_MPU_AP_RO : ARM_MPU_AP_FULL,
+						getMpuAccessAttributes(config.memoryType), config.subregionDisableMask,
+						getMpuSizeField(config.sizeInBytes) );
+
+	// disable the mpu while the region changes, so nothing is accessed with half written attributes
+	const bool mpuWasEnabled = MPU->CTRL & MPU_CTRL_ENABLE_Msk;
+	ARM_MPU_Disable();
+
+#ifndef CORE_CM4
+	// lines cached under the old attributes are written back and dropped, since the region may not be cacheable anymore
+	if ( LLPD::cache_dcache_is_enabled() )
+	{
+		SCB_CleanInvalidateDCache();
+	}
+#endif
+
+	ARM_MPU_SetRegionEx( config.regionNum, ARM_MPU_RBAR(config.regionNum, config.baseAddress), rasr );
+
+	if ( mpuWasEnabled )
+	{
+		LLPD::mpu_enable();
+	}
+
+	return true;
+}
+
+void LLPD::mpu_disable_region (const uint8_t regionNum)
+{
+	if ( regionNum >= LLPD::mpu_get_num_regions() )
+	{
+		return;
+	}
+
+	const bool mpuWasEnabled = MPU->CTRL & MPU_CTRL_ENABLE_Msk;
+	ARM_MPU_Disable();
+
+#ifndef CORE_CM4
+	if ( LLPD::cache_dcache_is_enabled() )
+	{
+		SCB_CleanInvalidateDCache();
+	}
+#endif
+
+	ARM_MPU_ClrRegion( regionNum );
+
+	if ( mpuWasEnabled )
+	{
+		LLPD::mpu_enable();
+	}
+}
+
+unsigned int LLPD::mpu_get_num_regions()
+{
+	return ( MPU->TYPE & MPU_TYPE_DREGION_Msk ) >> MPU_TYPE_DREGION_Pos;
+}
+
+void LLPD::mpu_enable()
+{
+	// the default memory map stays in place for privileged accesses outside of the regions
+	ARM_MPU_Enable( MPU_CTRL_PRIVDEFENA_Msk );
+}
+
+void LLPD::mpu_disable()
+{
+	ARM_MPU_Disable();
+}
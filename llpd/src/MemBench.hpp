@@ -0,0 +1,209 @@
+#include "LLPD.hpp"
+
+static constexpr uint32_t MEM_BENCH_MIN_SIZE_IN_BYTES = 256;
+static constexpr uint32_t MEM_BENCH_BYTES_PER_TEST = 256 * 1024; // small buffers are repeated to this much traffic
+static constexpr uint32_t MEM_BENCH_STRIDE_IN_WORDS = ( CACHE_LINE_SIZE * 2 ) / sizeof(uint32_t);
+static constexpr uint32_t MEM_BENCH_SLOT_IN_WORDS = CACHE_LINE_SIZE / sizeof(uint32_t);
+
+static volatile uint32_t memBenchSink = 0; // keeps the read loops from being optimized out
+
+static uint32_t memBenchRead (volatile uint32_t* words, const uint32_t numWords, const uint32_t reps)
+{
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	uint32_t sum = 0;
+	for ( uint32_t rep = 0; rep < reps; rep++ )
+	{
+		for ( uint32_t word = 0; word < numWords; word += 4 )
+		{
+			sum += words[word] + words[word + 1] + words[word + 2] + words[word + 3];
+		}
+	}
+
+	const uint32_t cycles = DWT->CYCCNT - startCycles;
+	memBenchSink = sum;
+
+	return cycles;
+}
+
+static uint32_t memBenchWrite (volatile uint32_t* words, const uint32_t numWords, const uint32_t reps)
+{
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	for ( uint32_t rep = 0; rep < reps; rep++ )
+	{
+		for ( uint32_t word = 0; word < numWords; word += 4 )
+		{
+			words[word] = rep;
+			words[word + 1] = rep;
+			words[word + 2] = rep;
+			words[word + 3] = rep;
+		}
+	}
+
+	// make sure the buffered writes are done before stopping the count
+	__DSB();
+
+	return DWT->CYCCNT - startCycles;
+}
+
+static uint32_t memBenchCopy (volatile uint32_t* words, const uint32_t numWords, const uint32_t reps)
+{
+	volatile uint32_t* src = words;
+	volatile uint32_t* dst = words + ( numWords / 2 );
+	const uint32_t numCopyWords = numWords / 2;
+
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	for ( uint32_t rep = 0; rep < reps; rep++ )
+	{
+		for ( uint32_t word = 0; word < numCopyWords; word += 4 )
+		{
+			dst[word] = src[word];
+			dst[word + 1] = src[word + 1];
+			dst[word + 2] = src[word + 2];
+			dst[word + 3] = src[word + 3];
+		}
+	}
+
+	__DSB();
+
+	return DWT->CYCCNT - startCycles;
+}
+
+static uint32_t memBenchStridedRead (volatile uint32_t* words, const uint32_t numWords, const uint32_t reps, uint32_t& numReads)
+{
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	uint32_t sum = 0;
+	numReads = 0;
+	for ( uint32_t rep = 0; rep < reps; rep++ )
+	{
+		for ( uint32_t word = 0; word < numWords; word += MEM_BENCH_STRIDE_IN_WORDS )
+		{
+			sum += words[word];
+			numReads++;
+		}
+	}
+
+	const uint32_t cycles = DWT->CYCCNT - startCycles;
+	memBenchSink = sum;
+
+	return cycles;
+}
+
+static uint32_t memBenchRandomLoad (volatile uint32_t* words, const uint32_t numWords, const uint32_t numLoads)
+{
+	// sattolo's shuffle leaves the slot indices as a single random cycle, so following them visits every cache line
+	const uint32_t numSlots = numWords / MEM_BENCH_SLOT_IN_WORDS;
+	for ( uint32_t slot = 0; slot < numSlots; slot++ )
+	{
+		words[slot * MEM_BENCH_SLOT_IN_WORDS] = slot;
+	}
+
+	uint32_t random = 0x12345678;
+	for ( uint32_t slot = numSlots - 1; slot > 0; slot-- )
+	{
+		random = ( random * 1664525 ) + 1013904223;
+		const uint32_t otherSlot = random % slot;
+
+		const uint32_t temp = words[slot * MEM_BENCH_SLOT_IN_WORDS];
+		words[slot * MEM_BENCH_SLOT_IN_WORDS] = words[otherSlot * MEM_BENCH_SLOT_IN_WORDS];
+		words[otherSlot * MEM_BENCH_SLOT_IN_WORDS] = temp;
+	}
+
+	__DSB();
+
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	uint32_t slot = 0;
+	for ( uint32_t load = 0; load < numLoads; load++ )
+	{
+		slot = words[slot * MEM_BENCH_SLOT_IN_WORDS];
+	}
+
+	const uint32_t cycles = DWT->CYCCNT - startCycles;
+	memBenchSink = slot;
+
+	return cycles;
+}
+
+MEM_BENCH_RESULT LLPD::mem_bench_run (void* buffer, const uint32_t sizeInBytes)
+{
+	MEM_BENCH_RESULT result;
+	if ( buffer == nullptr || sizeInBytes < MEM_BENCH_MIN_SIZE_IN_BYTES )
+	{
+		return result;
+	}
+
+	// whole cache lines, so the copy halves and the random slots line up
+	volatile uint32_t* words = static_cast<volatile uint32_t*>( buffer );
+	const uint32_t numWords = ( sizeInBytes / (CACHE_LINE_SIZE * 2) ) * ( (CACHE_LINE_SIZE * 2) / sizeof(uint32_t) );
+	const uint32_t numBytes = numWords * sizeof(uint32_t);
+	const uint32_t reps = ( numBytes < MEM_BENCH_BYTES_PER_TEST ) ? MEM_BENCH_BYTES_PER_TEST / numBytes : 1;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	// the first pass warms up the caches, so the cached numbers are steady state
+	memBenchWrite( words, numWords, 1 );
+
+	const uint32_t coreFreq = LLPD::rcc_get_core_freq();
+	const uint64_t totalBytes = static_cast<uint64_t>( numBytes ) * reps;
+	result.writeMBps = mem_bandwidth_MBps( totalBytes, memBenchWrite(words, numWords, reps), coreFreq );
+	result.readMBps = mem_bandwidth_MBps( totalBytes, memBenchRead(words, numWords, reps), coreFreq );
+	result.copyMBps = mem_bandwidth_MBps( totalBytes / 2, memBenchCopy(words, numWords, reps), coreFreq );
+
+	uint32_t numReads = 0;
+	const uint32_t stridedCycles = memBenchStridedRead( words, numWords, reps * MEM_BENCH_STRIDE_IN_WORDS, numReads );
+	result.stridedReadCycles = static_cast<float>( stridedCycles ) / numReads;
+
+	const uint32_t numLoads = totalBytes / CACHE_LINE_SIZE;
+	result.randomLoadCycles = static_cast<float>( memBenchRandomLoad(words, numWords, numLoads) ) / numLoads;
+
+	__set_PRIMASK( primask );
+
+	return result;
+}
+
+static void logMemBenchResult (const USART_NUM& usartNum, const MEM_BENCH_RESULT& result)
+{
+	LLPD::usart_log_int( usartNum, "    read MB/s: ", result.readMBps );
+	LLPD::usart_log_int( usartNum, "    write MB/s: ", result.writeMBps );
+	LLPD::usart_log_int( usartNum, "    copy MB/s: ", result.copyMBps );
+	LLPD::usart_log_float( usartNum, "    strided read cycles: ", result.stridedReadCycles );
+	LLPD::usart_log_float( usartNum, "    random load cycles: ", result.randomLoadCycles );
+}
+
+void LLPD::mem_bench_log (const USART_NUM& usartNum, const char* regionName, void* buffer, const uint32_t sizeInBytes)
+{
+#ifdef CORE_CM4
+	LLPD::usart_log( usartNum, "cpu2" );
+	LLPD::usart_log( usartNum, regionName );
+	logMemBenchResult( usartNum, LLPD::mem_bench_run(buffer, sizeInBytes) );
+#else
+	LLPD::usart_log( usartNum, "cpu1" );
+	LLPD::usart_log( usartNum, regionName );
+
+	// the d-cache is put back the way it was afterwards, disabling it cleans it first so nothing is lost
+	const bool dcacheWasEnabled = LLPD::cache_dcache_is_enabled();
+
+	SCB_EnableDCache();
+	const MEM_BENCH_RESULT cachedResult = LLPD::mem_bench_run( buffer, sizeInBytes );
+	SCB_DisableDCache();
+	const MEM_BENCH_RESULT uncachedResult = LLPD::mem_bench_run( buffer, sizeInBytes );
+
+	if ( dcacheWasEnabled )
+	{
+		SCB_EnableDCache();
+	}
+
+	LLPD::usart_log( usartNum, "  d-cache on" );
+	logMemBenchResult( usartNum, cachedResult );
+	LLPD::usart_log( usartNum, "  d-cache off" );
+	logMemBenchResult( usartNum, uncachedResult );
+#endif
+}
@@ -3,7 +3,7 @@
 void LLPD::opamp_init (const OPAMP_NUM& opAmpNum)
 {
 	// enable clock to op amp
-	RCC->APB1HENR |= RCC_APB1HENR_OPAMPEN;
+	LLPD::periph_enable_clock( PERIPH::OPAMP_1_2 );
 
 	OPAMP_TypeDef* opAmp = nullptr;
 	if ( opAmpNum == OPAMP_NUM::OPAMP_1 )
@@ -0,0 +1,142 @@
+#include "LLPD.hpp"
+
+// peripherals enabled by this core, for powering down the rest
+static uint64_t periphUsedMask = 0;
+
+static_assert( NUM_PERIPHS <= 64, "periphUsedMask needs more bits" );
+
+static volatile uint32_t* getEnableReg (const RCC_BUS& bus)
+{
+	switch ( bus )
+	{
+		case RCC_BUS::AHB1:
+			return &( RCC->AHB1ENR );
+		case RCC_BUS::AHB2:
+			return &( RCC->AHB2ENR );
+		case RCC_BUS::AHB3:
+			return &( RCC->AHB3ENR );
+		case RCC_BUS::AHB4:
+			return &( RCC->AHB4ENR );
+		case RCC_BUS::APB1L:
+			return &( RCC->APB1LENR );
+		case RCC_BUS::APB1H:
+			return &( RCC->APB1HENR );
+		case RCC_BUS::APB2:
+			return &( RCC->APB2ENR );
+		case RCC_BUS::APB3:
+			return &( RCC->APB3ENR );
+		case RCC_BUS::APB4:
+			return &( RCC->APB4ENR );
+	}
+
+	return nullptr;
+}
+
+static volatile uint32_t* getResetReg (const RCC_BUS& bus)
+{
+	switch ( bus )
+	{
+		case RCC_BUS::AHB1:
+			return &( RCC->AHB1RSTR );
+		case RCC_BUS::AHB2:
+			return &( RCC->AHB2RSTR );
+		case RCC_BUS::AHB3:
+			return &( RCC->AHB3RSTR );
+		case RCC_BUS::AHB4:
+			return &( RCC->AHB4RSTR );
+		case RCC_BUS::APB1L:
+			return &( RCC->APB1LRSTR );
+		case RCC_BUS::APB1H:
+			return &( RCC->APB1HRSTR );
+		case RCC_BUS::APB2:
+			return &( RCC->APB2RSTR );
+		case RCC_BUS::APB3:
+			return &( RCC->APB3RSTR );
+		case RCC_BUS::APB4:
+			return &( RCC->APB4RSTR );
+	}
+
+	return nullptr;
+}
+
+static volatile uint32_t* getLowPowerEnableReg (const RCC_BUS& bus)
+{
+	switch ( bus )
+	{
+		case RCC_BUS::AHB1:
+			return &( RCC->AHB1LPENR );
+		case RCC_BUS::AHB2:
+			return &( RCC->AHB2LPENR );
+		case RCC_BUS::AHB3:
+			return &( RCC->AHB3LPENR );
+		case RCC_BUS::AHB4:
+			return &( RCC->AHB4LPENR );
+		case RCC_BUS::APB1L:
+			return &( RCC->APB1LLPENR );
+		case RCC_BUS::APB1H:
+			return &( RCC->APB1HLPENR );
+		case RCC_BUS::APB2:
+			return &( RCC->APB2LPENR );
+		case RCC_BUS::APB3:
+			return &( RCC->APB3LPENR );
+		case RCC_BUS::APB4:
+			return &( RCC->APB4LPENR );
+	}
+
+	return nullptr;
+}
+
+void LLPD::periph_enable_clock (const PERIPH& periph)
+{
+	const PERIPH_DESC& desc = periph_desc( periph );
+
+	*getEnableReg( desc.bus ) |= desc.enableMask;
+	if ( desc.lpEnableMask != 0 )
+	{
+		*getLowPowerEnableReg( desc.bus ) |= desc.lpEnableMask;
+	}
+
+	// read back to make sure the clock is running before the peripheral is accessed
+	(void) *getEnableReg( desc.bus );
+
+	periphUsedMask |= ( 1ULL << static_cast<unsigned int>(periph) );
+}
+
+void LLPD::periph_disable_clock (const PERIPH& periph)
+{
+	const PERIPH_DESC& desc = periph_desc( periph );
+
+	*getEnableReg( desc.bus ) &= ~(desc.enableMask);
+	if ( desc.lpEnableMask != 0 )
+	{
+		*getLowPowerEnableReg( desc.bus ) &= ~(desc.lpEnableMask);
+	}
+
+	periphUsedMask &= ~( 1ULL << static_cast<unsigned int>(periph) );
+}
+
+void LLPD::periph_reset (const PERIPH& periph)
+{
+	const PERIPH_DESC& desc = periph_desc( periph );
+
+	*getResetReg( desc.bus ) |= desc.resetMask;
+	*getResetReg( desc.bus ) &= ~(desc.resetMask);
+}
+
+bool LLPD::periph_clock_is_enabled (const PERIPH& periph)
+{
+	const PERIPH_DESC& desc = periph_desc( periph );
+
+	return *getEnableReg( desc.bus ) & desc.enableMask;
+}
+
+void LLPD::periph_power_down_unused()
+{
+	for ( unsigned int periphNum = 0; periphNum < NUM_PERIPHS; periphNum++ )
+	{
+		if ( ! (periphUsedMask & (1ULL << periphNum)) )
+		{
+			LLPD::periph_disable_clock( static_cast<PERIPH>(periphNum) );
+		}
+	}
+}
@@ -0,0 +1,192 @@
+#include "LLPD.hpp"
+
+// each core has its own power control register (the bit positions are the same for both)
+#ifdef CORE_CM4
+static volatile uint32_t* const pwrCurrentCoreCr = &( PWR->CPU2CR );
+#else
+static volatile uint32_t* const pwrCurrentCoreCr = &( PWR->CPUCR );
+#endif
+
+// lptim1 wakeup is exti line 47
+static constexpr uint32_t PWR_LPTIM1_EXTI_LINE_MASK = EXTI_IMR2_IM47;
+
+static constexpr uint32_t PWR_WAKEUP_TIMER_MAX_TICKS = 0xFFFF;
+static constexpr uint32_t PWR_WAKEUP_TIMER_MAX_PRESC = 7; // prescaler is 2 ^ presc
+
+static volatile uint32_t pwrWakeupTimerPresc = 0;
+static volatile uint32_t pwrWakeLatencyCycles = 0;
+
+void LLPD::pwr_wakeup_timer_setup()
+{
+	// keep hsi running for per_ck in stop modes
+	RCC->CR |= RCC_CR_HSIKERON;
+
+	// per_ck as lptim1 kernel clock (per_ck is hsi by default)
+	RCC->D2CCIP2R &= ~(RCC_D2CCIP2R_LPTIM1SEL);
+	RCC->D2CCIP2R |= 0b101 << RCC_D2CCIP2R_LPTIM1SEL_Pos;
+
+	// enable lptim1 peripheral clock, including in csleep
+	LLPD::periph_enable_clock( PERIPH::LPTIM_1 );
+
+	// reset registers
+	LLPD::periph_reset( PERIPH::LPTIM_1 );
+
+	// the autoreload match interrupt is only used to wake the core, it's cleared before interrupts are enabled again
+	LPTIM1->IER = LPTIM_IER_ARRMIE;
+
+	// unmask the lptim1 wakeup line for this core so it can wake the core from stop modes
+	exti_current_core()->IMR2 |= PWR_LPTIM1_EXTI_LINE_MASK;
+	NVIC_SetPriority( LPTIM1_IRQn, 0x00 );
+	NVIC_EnableIRQ( LPTIM1_IRQn );
+}
+
+static bool startWakeupTimer (const uint32_t microseconds)
+{
+	const uint32_t tickFreq = LLPD::rcc_get_clock_freq( RCC_CLOCK::PER );
+	const uint64_t ticks = ( static_cast<uint64_t>(microseconds) * tickFreq ) / 1000000;
+
+	// smallest prescaler that fits, for the best wake latency resolution
+	uint32_t presc = 0;
+	while ( presc < PWR_WAKEUP_TIMER_MAX_PRESC && (ticks >> presc) > PWR_WAKEUP_TIMER_MAX_TICKS )
+	{
+		presc++;
+	}
+
+	const uint32_t arrVal = ( ticks >> presc );
+	if ( arrVal > PWR_WAKEUP_TIMER_MAX_TICKS || arrVal < 2 )
+	{
+		return false;
+	}
+
+	// prescaler can only be changed while disabled
+	LPTIM1->CR = 0;
+	LPTIM1->CFGR = presc << LPTIM_CFGR_PRESC_Pos;
+	pwrWakeupTimerPresc = presc;
+
+	// autoreload can only be written while enabled
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM1->ARR = arrVal - 1;
+	while ( ! (LPTIM1->ISR & LPTIM_ISR_ARROK) ) {}
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF | LPTIM_ICR_ARRMCF;
+
+	// continuous mode so the counter keeps counting past the match, which is used to measure the wake latency
+	LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+
+	return true;
+}
+
+static uint32_t readWakeupTimerCounter()
+{
+	// the counter is clocked asynchronously, so it's only valid when two reads match
+	uint32_t cnt = LPTIM1->CNT;
+	uint32_t cntCheck = LPTIM1->CNT;
+	while ( cnt != cntCheck )
+	{
+		cnt = cntCheck;
+		cntCheck = LPTIM1->CNT;
+	}
+
+	return cnt;
+}
+
+void LLPD::pwr_enter_low_power_mode (const PWR_LOW_POWER_MODE& mode, const uint32_t wakeupMicroseconds)
+{
+	// interrupts stay masked until the clocks are restored, the core still wakes on pending interrupts
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	const bool useWakeupTimer = ( wakeupMicroseconds != 0 ) && startWakeupTimer( wakeupMicroseconds );
+
+	// save which clocks were running, since system stop turns off the hse and plls
+	const uint32_t savedOscillators = RCC->CR & ( RCC_CR_HSEON | RCC_CR_PLL1ON | RCC_CR_PLL2ON | RCC_CR_PLL3ON );
+	const uint32_t savedSysClk = RCC->CFGR & RCC_CFGR_SW;
+
+	if ( mode == PWR_LOW_POWER_MODE::CSLEEP )
+	{
+		SCB->SCR &= ~(SCB_SCR_SLEEPDEEP_Msk);
+	}
+	else
+	{
+		// stop instead of standby for every domain
+		*pwrCurrentCoreCr &= ~( PWR_CPUCR_PDDS_D1 | PWR_CPUCR_PDDS_D2 | PWR_CPUCR_PDDS_D3 );
+
+		// keep d3 (and the system) running for cstop, or let the system enter stop with the domains for dstop
+		if ( mode == PWR_LOW_POWER_MODE::CSTOP )
+		{
+			*pwrCurrentCoreCr |= PWR_CPUCR_RUN_D3;
+		}
+		else
+		{
+			*pwrCurrentCoreCr &= ~(PWR_CPUCR_RUN_D3);
+		}
+
+		// clear stop and standby flags
+		*pwrCurrentCoreCr |= PWR_CPUCR_CSSF;
+
+		SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+	}
+
+	// ensure all instructions are done before entering sleep
+	__DSB();
+	__ISB();
+
+	// wait for interrupt
+	__WFI();
+
+	SCB->SCR &= ~(SCB_SCR_SLEEPDEEP_Msk);
+
+	// restore the hse and plls if the system entered stop, the registers keep their settings
+	if ( (RCC->CR & savedOscillators) != savedOscillators )
+	{
+		if ( savedOscillators & RCC_CR_HSEON )
+		{
+			RCC->CR |= RCC_CR_HSEON;
+			while ( ! (RCC->CR & RCC_CR_HSERDY) ) {}
+		}
+
+		// the ready bits are one above the on bits for every pll
+		const uint32_t pllOnBits[3] = { RCC_CR_PLL1ON, RCC_CR_PLL2ON, RCC_CR_PLL3ON };
+		for ( const uint32_t pllOnBit : pllOnBits )
+		{
+			if ( savedOscillators & pllOnBit )
+			{
+				RCC->CR |= pllOnBit;
+				while ( ! (RCC->CR & (pllOnBit << 1)) ) {}
+			}
+		}
+	}
+
+	if ( (RCC->CFGR & RCC_CFGR_SW) != savedSysClk )
+	{
+		RCC->CFGR &= ~(RCC_CFGR_SW);
+		RCC->CFGR |= savedSysClk;
+		while ( (RCC->CFGR & RCC_CFGR_SWS) != (savedSysClk << RCC_CFGR_SWS_Pos) ) {}
+	}
+
+	if ( useWakeupTimer )
+	{
+		// the counter restarted from 0 at the match, so it holds the time since the wakeup event
+		if ( LPTIM1->ISR & LPTIM_ISR_ARRM )
+		{
+			const uint64_t ticks = static_cast<uint64_t>( readWakeupTimerCounter() ) << pwrWakeupTimerPresc;
+			const uint64_t cpuFreq = LLPD::rcc_get_core_freq();
+			pwrWakeLatencyCycles = static_cast<uint32_t>( (ticks * cpuFreq) / LLPD::rcc_get_clock_freq(RCC_CLOCK::PER) );
+		}
+		else // woken by something else
+		{
+			pwrWakeLatencyCycles = 0;
+		}
+
+		LPTIM1->CR = 0;
+		LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+		NVIC_ClearPendingIRQ( LPTIM1_IRQn );
+	}
+
+	__set_PRIMASK( primask );
+}
+
+uint32_t LLPD::pwr_get_wake_latency_cycles()
+{
+	return pwrWakeLatencyCycles;
+}
@@ -1,59 +1,270 @@
 #include "LLPD.hpp"
 
-static void ensureCorrectFlashLatency (unsigned int freq)
+static uint32_t rccHseFreq = 16000000;
+
+// max ahb (aclk) frequency for each wait state setting, by voltage scaling level (0 = not allowed at that level), with the
+// latency and programming delay for each setting also by level since the same wait states cover different ranges at each level
+static constexpr unsigned int FLASH_NUM_WS_SETTINGS = 6;
+static constexpr uint32_t flashMaxFreqs[4][FLASH_NUM_WS_SETTINGS] =
+{
+	{ 70000000, 140000000, 185000000, 210000000, 225000000, 240000000 }, 	// vos0
+	{ 70000000, 140000000, 185000000, 210000000, 225000000, 0         }, 	// vos1
+	{ 55000000, 110000000, 165000000, 225000000, 0,         0         }, 	// vos2
+	{ 45000000, 90000000,  135000000, 180000000, 225000000, 0         }  	// vos3
+};
+static constexpr uint32_t flashLatencies[4][FLASH_NUM_WS_SETTINGS] =
+{
+	{ FLASH_ACR_LATENCY_0WS, FLASH_ACR_LATENCY_1WS, FLASH_ACR_LATENCY_2WS, FLASH_ACR_LATENCY_2WS, FLASH_ACR_LATENCY_3WS,
+		FLASH_ACR_LATENCY_4WS }, 	// vos0
+	{ FLASH_ACR_LATENCY_0WS, FLASH_ACR_LATENCY_1WS, FLASH_ACR_LATENCY_2WS, FLASH_ACR_LATENCY_2WS, FLASH_ACR_LATENCY_3WS,
+		FLASH_ACR_LATENCY_4WS }, 	// vos1
+	{ FLASH_ACR_LATENCY_0WS, FLASH_ACR_LATENCY_1WS, FLASH_ACR_LATENCY_2WS, FLASH_ACR_LATENCY_3WS, FLASH_ACR_LATENCY_4WS,
+		FLASH_ACR_LATENCY_4WS }, 	// vos2
+	{ FLASH_ACR_LATENCY_0WS, FLASH_ACR_LATENCY_1WS, FLASH_ACR_LATENCY_2WS, FLASH_ACR_LATENCY_3WS, FLASH_ACR_LATENCY_4WS,
+		FLASH_ACR_LATENCY_4WS }  	// vos3
+};
+static constexpr uint32_t flashSgDelays[4][FLASH_NUM_WS_SETTINGS] =
+{
+	{ 0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1 }, // vos0
+	{ 0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1 }, // vos1
+	{ 0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1 }, // vos2
+	{ 0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_0, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1, FLASH_ACR_WRHIGHFREQ_1 }  // vos3
+};
+
+// freq is the ahb (aclk) frequency, if onlyIncrease is true the latency is left alone when it's already high enough
+static void ensureCorrectFlashLatency (unsigned int freq, unsigned int vos = 0, bool onlyIncrease = false)
 {
-	uint32_t intendedLatency = 0;
-	uint32_t intendedSgDelay = 0;
-	if ( freq <= 70000000 )
+	uint32_t intendedLatency = FLASH_ACR_LATENCY_15WS;
+	uint32_t intendedSgDelay = FLASH_ACR_WRHIGHFREQ_1;
+	for ( unsigned int setting = 0; setting < FLASH_NUM_WS_SETTINGS; setting++ )
 	{
-		intendedLatency = FLASH_ACR_LATENCY_0WS;
-		intendedSgDelay = 0;
+		if ( freq <= flashMaxFreqs[vos][setting] )
+		{
+			intendedLatency = flashLatencies[vos][setting];
+			intendedSgDelay = flashSgDelays[vos][setting];
+			break;
+		}
 	}
-	else if ( freq <= 140000000 )
+
+	if ( onlyIncrease && (FLASH->ACR & FLASH_ACR_LATENCY) >= intendedLatency )
 	{
-		intendedLatency = FLASH_ACR_LATENCY_1WS;
-		intendedSgDelay = FLASH_ACR_WRHIGHFREQ_0;
+		return;
 	}
-	else if ( freq <= 185000000 )
+
+	FLASH->ACR &= ~(FLASH_ACR_LATENCY);
+	FLASH->ACR |= intendedLatency;
+	FLASH->ACR &= ~(FLASH_ACR_WRHIGHFREQ);
+	FLASH->ACR |= intendedSgDelay;
+
+	// the new latency needs to be in effect before the clock changes
+	while ( (FLASH->ACR & FLASH_ACR_LATENCY) != intendedLatency ) {}
+}
+
+static void startPll (const RCC_PLL_NUM& pllNum, const RCC_PLL_CONFIG& config)
+{
+	uint32_t onBit = 0;
+	uint32_t readyBit = 0;
+	uint32_t divMMask = 0;
+	uint32_t divMPos = 0;
+	uint32_t rangeMask = 0;
+	uint32_t rangePos = 0;
+	uint32_t vcoSelBit = 0;
+	uint32_t fracEnBit = 0;
+	uint32_t divPEnBit = 0;
+	uint32_t divQEnBit = 0;
+	uint32_t divREnBit = 0;
+	volatile uint32_t* divr = nullptr;
+	volatile uint32_t* fracr = nullptr;
+
+	if ( pllNum == RCC_PLL_NUM::PLL_1 )
 	{
-		intendedLatency = FLASH_ACR_LATENCY_2WS;
-		intendedSgDelay = FLASH_ACR_WRHIGHFREQ_0;
+		onBit = RCC_CR_PLL1ON;
+		readyBit = RCC_CR_PLL1RDY;
+		divMMask = RCC_PLLCKSELR_DIVM1;
+		divMPos = RCC_PLLCKSELR_DIVM1_Pos;
+		rangeMask = RCC_PLLCFGR_PLL1RGE;
+		rangePos = RCC_PLLCFGR_PLL1RGE_Pos;
+		vcoSelBit = RCC_PLLCFGR_PLL1VCOSEL;
+		fracEnBit = RCC_PLLCFGR_PLL1FRACEN;
+		divPEnBit = RCC_PLLCFGR_DIVP1EN;
+		divQEnBit = RCC_PLLCFGR_DIVQ1EN;
+		divREnBit = RCC_PLLCFGR_DIVR1EN;
+		divr = &( RCC->PLL1DIVR );
+		fracr = &( RCC->PLL1FRACR );
 	}
-	else if ( freq <= 210000000 )
+	else if ( pllNum == RCC_PLL_NUM::PLL_2 )
 	{
-		intendedLatency = FLASH_ACR_LATENCY_2WS;
-		intendedSgDelay = FLASH_ACR_WRHIGHFREQ_1;
+		onBit = RCC_CR_PLL2ON;
+		readyBit = RCC_CR_PLL2RDY;
+		divMMask = RCC_PLLCKSELR_DIVM2;
+		divMPos = RCC_PLLCKSELR_DIVM2_Pos;
+		rangeMask = RCC_PLLCFGR_PLL2RGE;
+		rangePos = RCC_PLLCFGR_PLL2RGE_Pos;
+		vcoSelBit = RCC_PLLCFGR_PLL2VCOSEL;
+		fracEnBit = RCC_PLLCFGR_PLL2FRACEN;
+		divPEnBit = RCC_PLLCFGR_DIVP2EN;
+		divQEnBit = RCC_PLLCFGR_DIVQ2EN;
+		divREnBit = RCC_PLLCFGR_DIVR2EN;
+		divr = &( RCC->PLL2DIVR );
+		fracr = &( RCC->PLL2FRACR );
 	}
-	else if ( freq <= 225000000 )
+	else // RCC_PLL_NUM::PLL_3
 	{
-		intendedLatency = FLASH_ACR_LATENCY_3WS;
-		intendedSgDelay = FLASH_ACR_WRHIGHFREQ_1;
+		onBit = RCC_CR_PLL3ON;
+		readyBit = RCC_CR_PLL3RDY;
+		divMMask = RCC_PLLCKSELR_DIVM3;
+		divMPos = RCC_PLLCKSELR_DIVM3_Pos;
+		rangeMask = RCC_PLLCFGR_PLL3RGE;
+		rangePos = RCC_PLLCFGR_PLL3RGE_Pos;
+		vcoSelBit = RCC_PLLCFGR_PLL3VCOSEL;
+		fracEnBit = RCC_PLLCFGR_PLL3FRACEN;
+		divPEnBit = RCC_PLLCFGR_DIVP3EN;
+		divQEnBit = RCC_PLLCFGR_DIVQ3EN;
+		divREnBit = RCC_PLLCFGR_DIVR3EN;
+		divr = &( RCC->PLL3DIVR );
+		fracr = &( RCC->PLL3FRACR );
 	}
-	else if ( freq <= 240000000 )
+
+	// disable pll
+	RCC->CR &= ~(onBit);
+
+	// wait until pll is disabled
+	while ( RCC->CR & readyBit ) {}
+
+	// set prescaler for pll
+	RCC->PLLCKSELR &= ~(divMMask);
+	RCC->PLLCKSELR |= config.divM << divMPos;
+
+	// set pll input frequency range, output frequency range and enabled outputs
+	uint32_t cfgrVal = RCC->PLLCFGR & ~( rangeMask | vcoSelBit | fracEnBit | divPEnBit | divQEnBit | divREnBit );
+	cfgrVal |= config.inputRange << rangePos;
+	cfgrVal |= ( config.mediumVco ) ? vcoSelBit : 0;
+	cfgrVal |= ( config.divP != 0 ) ? divPEnBit : 0;
+	cfgrVal |= ( config.divQ != 0 ) ? divQEnBit : 0;
+	cfgrVal |= ( config.divR != 0 ) ? divREnBit : 0;
+	RCC->PLLCFGR = cfgrVal;
+
+	// set pll multiply and output dividers (register values are the divider - 1, the divxr fields are the same for all plls)
+	*divr = ( (config.divN - 1) << RCC_PLL1DIVR_N1_Pos )
+		| ( ((config.divP != 0) ? config.divP - 1 : 0) << RCC_PLL1DIVR_P1_Pos )
+		| ( ((config.divQ != 0) ? config.divQ - 1 : 0) << RCC_PLL1DIVR_Q1_Pos )
+		| ( ((config.divR != 0) ? config.divR - 1 : 0) << RCC_PLL1DIVR_R1_Pos );
+
+	// set pll fract (latched when fracen is set)
+	*fracr = config.fracN << RCC_PLL1FRACR_FRACN1_Pos;
+	if ( config.fracN != 0 )
 	{
-		intendedLatency = FLASH_ACR_LATENCY_4WS;
-		intendedSgDelay = FLASH_ACR_WRHIGHFREQ_1;
+		RCC->PLLCFGR |= fracEnBit;
 	}
-	else
+
+	// enable pll
+	RCC->CR |= onBit;
+
+	// wait until pll is ready
+	while ( ! (RCC->CR & readyBit) ) {}
+}
+
+static void setBusPrescalers (const RCC_CLOCK_CONFIG& config)
+{
+	RCC->D1CFGR &= ~(RCC_D1CFGR_HPRE);
+	RCC->D1CFGR |= config.hpre << RCC_D1CFGR_HPRE_Pos;
+	RCC->D1CFGR &= ~(RCC_D1CFGR_D1PPRE);
+	RCC->D1CFGR |= config.ppre << RCC_D1CFGR_D1PPRE_Pos;
+	RCC->D2CFGR &= ~(RCC_D2CFGR_D2PPRE1);
+	RCC->D2CFGR |= config.ppre << RCC_D2CFGR_D2PPRE1_Pos;
+	RCC->D2CFGR &= ~(RCC_D2CFGR_D2PPRE2);
+	RCC->D2CFGR |= config.ppre << RCC_D2CFGR_D2PPRE2_Pos;
+	RCC->D3CFGR &= ~(RCC_D3CFGR_D3PPRE);
+	RCC->D3CFGR |= config.ppre << RCC_D3CFGR_D3PPRE_Pos;
+}
+
+// lowest voltage scaling level (highest vos number) that supports the given frequencies
+static unsigned int getVosForClocks (const uint32_t sysFreq, const uint32_t ahbFreq)
+{
+	if ( sysFreq <= 200000000 && ahbFreq <= 100000000 )
+	{
+		return 3;
+	}
+	else if ( sysFreq <= 300000000 && ahbFreq <= 150000000 )
+	{
+		return 2;
+	}
+	else if ( sysFreq <= 400000000 && ahbFreq <= 200000000 )
 	{
-		intendedLatency = FLASH_ACR_LATENCY_15WS;
-		intendedSgDelay = FLASH_ACR_WRHIGHFREQ_1;
+		return 1;
 	}
 
-	FLASH->ACR &= ~(FLASH_ACR_LATENCY);
-	FLASH->ACR |= intendedLatency;
-	FLASH->ACR &= ~(FLASH_ACR_WRHIGHFREQ);
-	FLASH->ACR |= intendedSgDelay;
+	return 0;
+}
+
+static unsigned int getCurrentVos()
+{
+	if ( SYSCFG->PWRCR & SYSCFG_PWRCR_ODEN )
+	{
+		return 0;
+	}
+
+	// vos field values are 0b11 = scale 1, 0b10 = scale 2, 0b01 = scale 3
+	return 4 - ( (PWR->D3CR & PWR_D3CR_VOS) >> PWR_D3CR_VOS_Pos );
+}
+
+static void setVos (const unsigned int vos)
+{
+	// vos0 is scale 1 with the ldo overdrive enabled, overdrive needs to be disabled before leaving scale 1
+	if ( vos != 0 && (SYSCFG->PWRCR & SYSCFG_PWRCR_ODEN) )
+	{
+		SYSCFG->PWRCR &= ~(SYSCFG_PWRCR_ODEN);
+
+		// wait until ready
+		while ( ! (PWR->D3CR & PWR_D3CR_VOSRDY) ) {}
+	}
+
+	const uint32_t vosVal = ( vos == 0 ) ? 0b11 : 4 - vos;
+	PWR->D3CR = ( PWR->D3CR & ~(PWR_D3CR_VOS) ) | ( vosVal << PWR_D3CR_VOS_Pos );
+
+	// wait until ready
+	while ( ! (PWR->D3CR & PWR_D3CR_VOSRDY) ) {}
+
+	if ( vos == 0 )
+	{
+		// set LDO overdrive to enabled
+		SYSCFG->PWRCR |= SYSCFG_PWRCR_ODEN;
+
+		// wait until ready
+		while ( ! (PWR->D3CR & PWR_D3CR_VOSRDY) ) {}
+	}
 }
 
 void LLPD::rcc_clock_start_max_cpu1 (const unsigned int pll1qPresc)
+{
+	// 16 MHz hse / 1 * 60 = 960 MHz vco, sys_ck = 480 MHz, ahb = 240 MHz, apb = 120 MHz
+	RCC_CLOCK_CONFIG config;
+	config.pll1.divM = 1;
+	config.pll1.divN = 60;
+	config.pll1.divP = 2;
+	config.pll1.divQ = pll1qPresc;
+	config.pll1.inputRange = 3;
+	config.pll1.mediumVco = false;
+	config.pll1.valid = true;
+	config.hseFreq = 16000000;
+	config.sysFreq = 480000000;
+	config.ahbFreq = 240000000;
+	config.apbFreq = 120000000;
+	config.hpre = rcc_hpre_value( 2 );
+	config.ppre = rcc_ppre_value( 2 );
+	config.valid = true;
+
+	LLPD::rcc_clock_start_cpu1( config );
+}
+
+void LLPD::rcc_clock_start_cpu1 (const RCC_CLOCK_CONFIG& config)
 {
 // initial stuff
 	// wait for d2ckrdy == reset in rcc to wait for cpu 2 to enter stop mode
 	while ( RCC->CR & RCC_CR_D2CKRDY ) {}
 
 	// enable syscfg clock
-	RCC->APB4ENR |= RCC_APB4ENR_SYSCFGEN;
+	LLPD::periph_enable_clock( PERIPH::SYS_CFG );
 
 // setup power stuff
 	// enable LDO
@@ -74,93 +285,50 @@ void LLPD::rcc_clock_start_max_cpu1 (const unsigned int pll1qPresc)
 	// wait until ready
 	while ( ! (PWR->D3CR & PWR_D3CR_VOSRDY) ) {}
 // clock stuff
+	if ( config.hseFreq != 0 )
+	{
+		rccHseFreq = config.hseFreq;
+	}
+
 	// enable hse
 	RCC->CR |= RCC_CR_HSEON;
 
 	// wait until hse ready
 	while ( ! (RCC->CR & RCC_CR_HSERDY) ) {}
 
-	// disable pll
-	RCC->CR &= ~(RCC_CR_PLL1ON);
-
-	// wait until pll is disabled
-	while ( RCC->CR & RCC_CR_PLL1RDY ) {}
-
-	// set prescaler for pll1
-	RCC->PLLCKSELR &= ~(RCC_PLLCKSELR_DIVM1);
-	RCC->PLLCKSELR |= RCC_PLLCKSELR_DIVM1_0;
-
-	// select source for pll clock
+	// set up and start pll1 from hse
 	RCC->PLLCKSELR &= ~(RCC_PLLCKSELR_PLLSRC);
 	RCC->PLLCKSELR |= RCC_PLLCKSELR_PLLSRC_HSE;
-
-	// enable pll divp1 output
-	RCC->PLLCFGR |= RCC_PLLCFGR_DIVP1EN;
-
-	// enable pll divq1 output
-	RCC->PLLCFGR |= RCC_PLLCFGR_DIVQ1EN;
-
-	// set pll input frequency range
-	RCC->PLLCFGR |= RCC_PLLCFGR_PLL1RGE;
-
-	// set pll output frequency range
-	RCC->PLLCFGR &= ~(RCC_PLLCFGR_PLL1VCOSEL);
-
-	// set pll 1 divp prescaler value
-	RCC->PLL1DIVR &= ~(RCC_PLL1DIVR_P1);
-	RCC->PLL1DIVR |= (1 << RCC_PLL1DIVR_P1_Pos);
-
-	// set pll 1 divq prescaler value
-	RCC->PLL1DIVR &= ~(RCC_PLL1DIVR_Q1);
-	RCC->PLL1DIVR |= ( (pll1qPresc - 1) << RCC_PLL1DIVR_Q1_Pos );
-
-	// set pll multiply
-	RCC->PLL1DIVR &= ~(RCC_PLL1DIVR_N1);
-	RCC->PLL1DIVR |= ( (60 - 1) << RCC_PLL1DIVR_N1_Pos );
-
-	// disable pll fract
-	RCC->PLLCFGR &= ~(RCC_PLLCFGR_PLL1FRACEN);
-
-	// enable main pll
-	RCC->CR |= RCC_CR_PLL1ON;
-
-	// wait until pll is ready
-	while ( ! (RCC_CR_PLL1RDY) ) {}
+	startPll( RCC_PLL_NUM::PLL_1, config.pll1 );
 
 	// set clock dividers
-	RCC->D1CFGR &= ~(RCC_D1CFGR_HPRE);
-	RCC->D1CFGR |= RCC_D1CFGR_HPRE_DIV2;
-	RCC->D1CFGR &= ~(RCC_D1CFGR_D1PPRE);
-	RCC->D1CFGR |= RCC_D1CFGR_D1PPRE_DIV2;
-	RCC->D2CFGR &= ~(RCC_D2CFGR_D2PPRE1);
-	RCC->D2CFGR |= RCC_D2CFGR_D2PPRE1_DIV2;
-	RCC->D2CFGR &= ~(RCC_D2CFGR_D2PPRE2);
-	RCC->D2CFGR |= RCC_D2CFGR_D2PPRE2_DIV2;
-	RCC->D3CFGR &= ~(RCC_D3CFGR_D3PPRE);
-	RCC->D3CFGR |= RCC_D3CFGR_D3PPRE_DIV2;
+	setBusPrescalers( config );
 
 	// increase flash latency if necessary
-	ensureCorrectFlashLatency( 240000000 );
+	ensureCorrectFlashLatency( config.ahbFreq, 0, true );
 
 	// set system clock as pll
 	RCC->CFGR &= ~(RCC_CFGR_SW);
 	RCC->CFGR |= RCC_CFGR_SW_PLL1;
 
-	// decrease flash latency if necessary // TODO just leaving this as a reminder to do so if I write more generic code
-	ensureCorrectFlashLatency( 240000000 );
+	// wait until the switch is complete
+	while ( (RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL1 ) {}
+
+	// decrease flash latency if necessary
+	ensureCorrectFlashLatency( config.ahbFreq );
 
 	// enable clock security system
 	RCC->CR |= RCC_CR_CSSHSEON;
 
 // core synchronization stuff
 	// enable hardware semaphore clock
-	RCC->AHB4ENR |= RCC_AHB4ENR_HSEMEN;
+	LLPD::periph_enable_clock( PERIPH::HW_SEM );
 
 	// take the semaphore (spinlock to catch if not taken)
 	while ( HSEM->RLR[0] != (HSEM_CR_COREID_CURRENT | HSEM_RLR_LOCK) ) {}
 
 	// set the setupCompleteFlag to false
-	bool* volatile setupCompleteFlag = reinterpret_cast<bool*>( D2_AHBSRAM_BASE );
+	bool* volatile setupCompleteFlag = reinterpret_cast<bool*>( sram_slot_address(SRAM_SLOT::CORE_SYNC) );
 	*setupCompleteFlag = false;
 
 	// release the semaphore to notifiy to CPU2 that everything is cool
@@ -168,13 +336,17 @@ void LLPD::rcc_clock_start_max_cpu1 (const unsigned int pll1qPresc)
 
 	// wait for d2ckrdy flag to == set in rcc to wait for cpu to enter run mode
 	while ( ! (RCC->CR & RCC_CR_D2CKRDY) ) {}
+
+// cache stuff
+	// enabled after the handshake, since the setupCompleteFlag is shared with cpu2
+	LLPD::cache_enable();
 }
 
 void LLPD::rcc_clock_start_max_cpu2()
 {
 // core syncronization stuff
 	// enable hardware semaphore clock
-	RCC->AHB4ENR |= RCC_AHB4ENR_HSEMEN;
+	LLPD::periph_enable_clock( PERIPH::HW_SEM );
 
 	// activate hardware semaphore notification for cortex m4
 	if ( HSEM_CR_COREID_CURRENT == HSEM_CR_COREID_CPU1 )
@@ -215,41 +387,21 @@ void LLPD::rcc_clock_start_max_cpu2()
 
 void LLPD::rcc_start_pll2 (const unsigned int pllMultiply)
 {
-	// disable pll
-	RCC->CR &= ~(RCC_CR_PLL2ON);
-
-	// wait until pll is disabled
-	while ( RCC->CR & RCC_CR_PLL2RDY ) {}
-
-	// set prescaler for pll2 (16 MHz / 16 = 1 MHz)
-	RCC->PLLCKSELR &= ~(RCC_PLLCKSELR_DIVM2);
-	RCC->PLLCKSELR |= 16 << RCC_PLLCKSELR_DIVM2_Pos;
-
-	// set pll input frequency range
-	RCC->PLLCFGR &= ~(RCC_PLLCFGR_PLL2RGE);
-
-	// enable pll divr2 output
-	RCC->PLLCFGR |= RCC_PLLCFGR_DIVR2EN;
-
-	// set pll output frequency range
-	RCC->PLLCFGR |= RCC_PLLCFGR_PLL2VCOSEL;
-
-	// set pll fract
-	RCC->PLLCFGR &= ~(RCC_PLLCFGR_PLL2FRACEN);
-
-	// set pll2 divr prescaler value
-	RCC->PLL2DIVR &= ~(RCC_PLL2DIVR_R2);
-	RCC->PLL2DIVR |= 0 << RCC_PLL2DIVR_R2_Pos;
-
-	// // set pll multiply
-	RCC->PLL2DIVR &= ~(RCC_PLL2DIVR_N2);
-	RCC->PLL2DIVR |= ( (pllMultiply - 1) << RCC_PLL2DIVR_N2_Pos );
-
-	// enable pll
-	RCC->CR |= RCC_CR_PLL2ON;
+	// 16 MHz hse / 16 = 1 MHz reference, divr2 = 1
+	RCC_PLL_CONFIG config;
+	config.divM = 16;
+	config.divN = pllMultiply;
+	config.divR = 1;
+	config.inputRange = 0;
+	config.mediumVco = true;
+	config.valid = true;
+
+	LLPD::rcc_start_pll2( config );
+}
 
-	// wait until pll is ready
-	while ( ! (RCC_CR_PLL2RDY) ) {}
+void LLPD::rcc_start_pll2 (const RCC_PLL_CONFIG& config)
+{
+	startPll( RCC_PLL_NUM::PLL_2, config );
 
 	// TODO maybe move this somewhere else
 	// ensure fmc use pll2 divr
@@ -259,48 +411,420 @@ void LLPD::rcc_start_pll2 (const unsigned int pllMultiply)
 	RCC->D1CCIPR &= ~(RCC_D1CCIPR_SDMMCSEL);
 	RCC->D1CCIPR |= RCC_D1CCIPR_SDMMCSEL;
 	// enable fmc peripheral clock
-	RCC->AHB3ENR |= RCC_AHB3ENR_FMCEN;
+	LLPD::periph_enable_clock( PERIPH::FMC );
 }
 
 void LLPD::rcc_start_pll3 (const unsigned int pllMultiply)
 {
-	// disable pll
-	RCC->CR &= ~(RCC_CR_PLL3ON);
+	// 16 MHz hse / 16 = 1 MHz reference, divr3 = 5
+	RCC_PLL_CONFIG config;
+	config.divM = 16;
+	config.divN = pllMultiply;
+	config.divR = 5;
+	config.inputRange = 0;
+	config.mediumVco = true;
+	config.valid = true;
+
+	LLPD::rcc_start_pll3( config );
+}
 
-	// wait until pll is disabled
-	while ( RCC->CR & RCC_CR_PLL3RDY ) {}
+void LLPD::rcc_start_pll3 (const RCC_PLL_CONFIG& config)
+{
+	startPll( RCC_PLL_NUM::PLL_3, config );
 
-	// set prescaler for pll3 (16 MHz / 16 = 1 MHz)
-	RCC->PLLCKSELR &= ~(RCC_PLLCKSELR_DIVM3);
-	RCC->PLLCKSELR |= 16 << RCC_PLLCKSELR_DIVM3_Pos;
+	// TODO maybe move this somewhere else
+	// enable ltdc peripheral clock
+	LLPD::periph_enable_clock( PERIPH::LTDC_1 );
+}
 
-	// set pll input frequency range
-	RCC->PLLCFGR &= ~(RCC_PLLCFGR_PLL3RGE);
+void LLPD::rcc_set_hse_freq (const uint32_t hseFreq)
+{
+	rccHseFreq = hseFreq;
+}
 
-	// enable pll divr3 output
-	RCC->PLLCFGR |= RCC_PLLCFGR_DIVR3EN;
+static uint32_t getPllOutputFreq (const RCC_PLL_NUM& pllNum, const unsigned int outputNum) // output 0 = p, 1 = q, 2 = r
+{
+	uint32_t readyBit = 0;
+	uint32_t divM = 0;
+	uint32_t fracEnBit = 0;
+	uint32_t divEnBit = 0;
+	uint32_t divrVal = 0;
+	uint32_t fracrVal = 0;
+
+	if ( pllNum == RCC_PLL_NUM::PLL_1 )
+	{
+		readyBit = RCC_CR_PLL1RDY;
+		divM = ( RCC->PLLCKSELR & RCC_PLLCKSELR_DIVM1 ) >> RCC_PLLCKSELR_DIVM1_Pos;
+		fracEnBit = RCC_PLLCFGR_PLL1FRACEN;
+		divEnBit = RCC_PLLCFGR_DIVP1EN << outputNum;
+		divrVal = RCC->PLL1DIVR;
+		fracrVal = RCC->PLL1FRACR;
+	}
+	else if ( pllNum == RCC_PLL_NUM::PLL_2 )
+	{
+		readyBit = RCC_CR_PLL2RDY;
+		divM = ( RCC->PLLCKSELR & RCC_PLLCKSELR_DIVM2 ) >> RCC_PLLCKSELR_DIVM2_Pos;
+		fracEnBit = RCC_PLLCFGR_PLL2FRACEN;
+		divEnBit = RCC_PLLCFGR_DIVP2EN << outputNum;
+		divrVal = RCC->PLL2DIVR;
+		fracrVal = RCC->PLL2FRACR;
+	}
+	else // RCC_PLL_NUM::PLL_3
+	{
+		readyBit = RCC_CR_PLL3RDY;
+		divM = ( RCC->PLLCKSELR & RCC_PLLCKSELR_DIVM3 ) >> RCC_PLLCKSELR_DIVM3_Pos;
+		fracEnBit = RCC_PLLCFGR_PLL3FRACEN;
+		divEnBit = RCC_PLLCFGR_DIVP3EN << outputNum;
+		divrVal = RCC->PLL3DIVR;
+		fracrVal = RCC->PLL3FRACR;
+	}
 
-	// set pll output frequency range
-	RCC->PLLCFGR |= RCC_PLLCFGR_PLL3VCOSEL;
+	if ( ! (RCC->CR & readyBit) || ! (RCC->PLLCFGR & divEnBit) || divM == 0 )
+	{
+		return 0;
+	}
 
-	// set pll fract
-	RCC->PLLCFGR &= ~(RCC_PLLCFGR_PLL3FRACEN);
+	// pll source is shared by all plls
+	uint32_t srcFreq = 0;
+	const uint32_t pllSrc = RCC->PLLCKSELR & RCC_PLLCKSELR_PLLSRC;
+	if ( pllSrc == RCC_PLLCKSELR_PLLSRC_HSI )
+	{
+		srcFreq = LLPD::rcc_get_clock_freq( RCC_CLOCK::HSI );
+	}
+	else if ( pllSrc == RCC_PLLCKSELR_PLLSRC_CSI )
+	{
+		srcFreq = RCC_CSI_FREQ;
+	}
+	else if ( pllSrc == RCC_PLLCKSELR_PLLSRC_HSE )
+	{
+		srcFreq = rccHseFreq;
+	}
 
-	// set pll3 divr prescaler value
-	RCC->PLL3DIVR &= ~(RCC_PLL3DIVR_R3);
-	RCC->PLL3DIVR |= (5 - 1) << RCC_PLL3DIVR_R3_Pos;
+	// the divxr and fracxr fields are the same for all plls
+	const uint32_t divN = ( (divrVal & RCC_PLL1DIVR_N1) >> RCC_PLL1DIVR_N1_Pos ) + 1;
+	const uint32_t fracN = ( RCC->PLLCFGR & fracEnBit ) ? ( fracrVal & RCC_PLL1FRACR_FRACN1 ) >> RCC_PLL1FRACR_FRACN1_Pos : 0;
+	uint32_t div = 1;
+	if ( outputNum == 0 )
+	{
+		div = ( (divrVal & RCC_PLL1DIVR_P1) >> RCC_PLL1DIVR_P1_Pos ) + 1;
+	}
+	else if ( outputNum == 1 )
+	{
+		div = ( (divrVal & RCC_PLL1DIVR_Q1) >> RCC_PLL1DIVR_Q1_Pos ) + 1;
+	}
+	else
+	{
+		div = ( (divrVal & RCC_PLL1DIVR_R1) >> RCC_PLL1DIVR_R1_Pos ) + 1;
+	}
 
-	// // set pll multiply
-	RCC->PLL3DIVR &= ~(RCC_PLL3DIVR_N3);
-	RCC->PLL3DIVR |= ( (pllMultiply - 1) << RCC_PLL3DIVR_N3_Pos );
+	return rcc_pll_output_freq( srcFreq, divM, (static_cast<uint64_t>(divN) * RCC_PLL_FRAC_SCALE) + fracN, div );
+}
 
-	// enable pll
-	RCC->CR |= RCC_CR_PLL3ON;
+static uint32_t getHpreDiv (const uint32_t hpre) // also used for D1CPRE
+{
+	if ( hpre < 0b1000 )
+	{
+		return 1;
+	}
+	else if ( hpre < 0b1100 )
+	{
+		return 2 << ( hpre - 0b1000 );
+	}
 
-	// wait until pll is ready
-	while ( ! (RCC_CR_PLL3RDY) ) {}
+	// there is no divide by 32
+	return 64 << ( hpre - 0b1100 );
+}
 
-	// TODO maybe move this somewhere else
-	// enable ltdc peripheral clock
-	RCC->APB3ENR |= RCC_APB3ENR_LTDCEN;
+static uint32_t getPpreDiv (const uint32_t ppre)
+{
+	if ( ppre < 0b100 )
+	{
+		return 1;
+	}
+
+	return 2 << ( ppre - 0b100 );
+}
+
+static uint32_t getTimerFreq (const uint32_t ppre)
+{
+	const uint32_t ahbFreq = LLPD::rcc_get_clock_freq( RCC_CLOCK::AHB );
+	const uint32_t ppreDiv = getPpreDiv( ppre );
+
+	// timers run at twice the apb frequency (four times with timpre) but no faster than the ahb
+	const uint32_t timerMul = ( RCC->CFGR & RCC_CFGR_TIMPRE ) ? 4 : 2;
+	if ( ppreDiv <= timerMul )
+	{
+		return ahbFreq;
+	}
+
+	return ( ahbFreq / ppreDiv ) * timerMul;
+}
+
+uint32_t LLPD::rcc_get_clock_freq (const RCC_CLOCK& clock)
+{
+	switch ( clock )
+	{
+		case RCC_CLOCK::HSI:
+			return ( RCC->CR & RCC_CR_HSIRDY ) ? RCC_HSI_FREQ >> ( (RCC->CR & RCC_CR_HSIDIV) >> RCC_CR_HSIDIV_Pos ) : 0;
+		case RCC_CLOCK::CSI:
+			return ( RCC->CR & RCC_CR_CSIRDY ) ? RCC_CSI_FREQ : 0;
+		case RCC_CLOCK::HSE:
+			return ( RCC->CR & RCC_CR_HSERDY ) ? rccHseFreq : 0;
+		case RCC_CLOCK::LSE:
+			return ( RCC->BDCR & RCC_BDCR_LSERDY ) ? RCC_LSE_FREQ : 0;
+		case RCC_CLOCK::PER:
+		{
+			const uint32_t perSel = ( RCC->D1CCIPR & RCC_D1CCIPR_CKPERSEL ) >> RCC_D1CCIPR_CKPERSEL_Pos;
+			if ( perSel == 0 )
+			{
+				return rcc_get_clock_freq( RCC_CLOCK::HSI );
+			}
+			else if ( perSel == 1 )
+			{
+				return rcc_get_clock_freq( RCC_CLOCK::CSI );
+			}
+			else if ( perSel == 2 )
+			{
+				return rcc_get_clock_freq( RCC_CLOCK::HSE );
+			}
+
+			return 0;
+		}
+		case RCC_CLOCK::PLL1_P:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_1, 0 );
+		case RCC_CLOCK::PLL1_Q:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_1, 1 );
+		case RCC_CLOCK::PLL1_R:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_1, 2 );
+		case RCC_CLOCK::PLL2_P:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_2, 0 );
+		case RCC_CLOCK::PLL2_Q:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_2, 1 );
+		case RCC_CLOCK::PLL2_R:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_2, 2 );
+		case RCC_CLOCK::PLL3_P:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_3, 0 );
+		case RCC_CLOCK::PLL3_Q:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_3, 1 );
+		case RCC_CLOCK::PLL3_R:
+			return getPllOutputFreq( RCC_PLL_NUM::PLL_3, 2 );
+		case RCC_CLOCK::SYS:
+		{
+			const uint32_t sws = RCC->CFGR & RCC_CFGR_SWS;
+			if ( sws == RCC_CFGR_SWS_HSI )
+			{
+				return rcc_get_clock_freq( RCC_CLOCK::HSI );
+			}
+			else if ( sws == RCC_CFGR_SWS_CSI )
+			{
+				return rcc_get_clock_freq( RCC_CLOCK::CSI );
+			}
+			else if ( sws == RCC_CFGR_SWS_HSE )
+			{
+				return rcc_get_clock_freq( RCC_CLOCK::HSE );
+			}
+
+			return rcc_get_clock_freq( RCC_CLOCK::PLL1_P );
+		}
+		case RCC_CLOCK::CPU1:
+			return rcc_get_clock_freq( RCC_CLOCK::SYS ) / getHpreDiv( (RCC->D1CFGR & RCC_D1CFGR_D1CPRE) >> RCC_D1CFGR_D1CPRE_Pos );
+		case RCC_CLOCK::AHB:
+			return rcc_get_clock_freq( RCC_CLOCK::CPU1 ) / getHpreDiv( (RCC->D1CFGR & RCC_D1CFGR_HPRE) >> RCC_D1CFGR_HPRE_Pos );
+		case RCC_CLOCK::APB1:
+			return rcc_get_clock_freq( RCC_CLOCK::AHB ) / getPpreDiv( (RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) >> RCC_D2CFGR_D2PPRE1_Pos );
+		case RCC_CLOCK::APB2:
+			return rcc_get_clock_freq( RCC_CLOCK::AHB ) / getPpreDiv( (RCC->D2CFGR & RCC_D2CFGR_D2PPRE2) >> RCC_D2CFGR_D2PPRE2_Pos );
+		case RCC_CLOCK::APB3:
+			return rcc_get_clock_freq( RCC_CLOCK::AHB ) / getPpreDiv( (RCC->D1CFGR & RCC_D1CFGR_D1PPRE) >> RCC_D1CFGR_D1PPRE_Pos );
+		case RCC_CLOCK::APB4:
+			return rcc_get_clock_freq( RCC_CLOCK::AHB ) / getPpreDiv( (RCC->D3CFGR & RCC_D3CFGR_D3PPRE) >> RCC_D3CFGR_D3PPRE_Pos );
+		case RCC_CLOCK::APB1_TIMER:
+			return getTimerFreq( (RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) >> RCC_D2CFGR_D2PPRE1_Pos );
+		case RCC_CLOCK::APB2_TIMER:
+			return getTimerFreq( (RCC->D2CFGR & RCC_D2CFGR_D2PPRE2) >> RCC_D2CFGR_D2PPRE2_Pos );
+	}
+
+	return 0;
+}
+
+// shared by the usart and spi4/5/6 kernel clock muxes, where only the value 0 differs
+static uint32_t getKernelMuxFreq (const uint32_t sel, const RCC_CLOCK& sel0Clock, const RCC_CLOCK& sel5Clock)
+{
+	if ( sel == 0 )
+	{
+		return LLPD::rcc_get_clock_freq( sel0Clock );
+	}
+	else if ( sel == 1 )
+	{
+		return LLPD::rcc_get_clock_freq( RCC_CLOCK::PLL2_Q );
+	}
+	else if ( sel == 2 )
+	{
+		return LLPD::rcc_get_clock_freq( RCC_CLOCK::PLL3_Q );
+	}
+	else if ( sel == 3 )
+	{
+		return LLPD::rcc_get_clock_freq( RCC_CLOCK::HSI );
+	}
+	else if ( sel == 4 )
+	{
+		return LLPD::rcc_get_clock_freq( RCC_CLOCK::CSI );
+	}
+	else if ( sel == 5 )
+	{
+		return LLPD::rcc_get_clock_freq( sel5Clock );
+	}
+
+	return 0;
+}
+
+uint32_t LLPD::rcc_get_usart_kernel_freq (const USART_NUM& usartNum)
+{
+	if ( usartNum == USART_NUM::USART_1 || usartNum == USART_NUM::USART_6 )
+	{
+		const uint32_t sel = ( RCC->D2CCIP2R & RCC_D2CCIP2R_USART16SEL ) >> RCC_D2CCIP2R_USART16SEL_Pos;
+
+		return getKernelMuxFreq( sel, RCC_CLOCK::APB2, RCC_CLOCK::LSE );
+	}
+
+	const uint32_t sel = ( RCC->D2CCIP2R & RCC_D2CCIP2R_USART28SEL ) >> RCC_D2CCIP2R_USART28SEL_Pos;
+
+	return getKernelMuxFreq( sel, RCC_CLOCK::APB1, RCC_CLOCK::LSE );
+}
+
+uint32_t LLPD::rcc_get_spi_kernel_freq (const SPI_NUM& spiNum)
+{
+	if ( spiNum == SPI_NUM::SPI_1 || spiNum == SPI_NUM::SPI_2 || spiNum == SPI_NUM::SPI_3 )
+	{
+		const uint32_t sel = ( RCC->D2CCIP1R & RCC_D2CCIP1R_SPI123SEL ) >> RCC_D2CCIP1R_SPI123SEL_Pos;
+		if ( sel == 0 )
+		{
+			return rcc_get_clock_freq( RCC_CLOCK::PLL1_Q );
+		}
+		else if ( sel == 1 )
+		{
+			return rcc_get_clock_freq( RCC_CLOCK::PLL2_P );
+		}
+		else if ( sel == 2 )
+		{
+			return rcc_get_clock_freq( RCC_CLOCK::PLL3_P );
+		}
+		else if ( sel == 4 )
+		{
+			return rcc_get_clock_freq( RCC_CLOCK::PER );
+		}
+
+		// external i2s_ckin can't be known
+		return 0;
+	}
+	else if ( spiNum == SPI_NUM::SPI_4 || spiNum == SPI_NUM::SPI_5 )
+	{
+		const uint32_t sel = ( RCC->D2CCIP1R & RCC_D2CCIP1R_SPI45SEL ) >> RCC_D2CCIP1R_SPI45SEL_Pos;
+
+		return getKernelMuxFreq( sel, RCC_CLOCK::APB2, RCC_CLOCK::HSE );
+	}
+
+	const uint32_t sel = ( RCC->D3CCIPR & RCC_D3CCIPR_SPI6SEL ) >> RCC_D3CCIPR_SPI6SEL_Pos;
+
+	return getKernelMuxFreq( sel, RCC_CLOCK::APB4, RCC_CLOCK::HSE );
+}
+
+uint32_t LLPD::rcc_get_sdmmc_kernel_freq()
+{
+	if ( RCC->D1CCIPR & RCC_D1CCIPR_SDMMCSEL )
+	{
+		return rcc_get_clock_freq( RCC_CLOCK::PLL2_R );
+	}
+
+	return rcc_get_clock_freq( RCC_CLOCK::PLL1_Q );
+}
+
+uint32_t LLPD::rcc_get_fmc_kernel_freq()
+{
+	switch ( (RCC->D1CCIPR & RCC_D1CCIPR_FMCSEL) >> RCC_D1CCIPR_FMCSEL_Pos )
+	{
+		case 0b00:
+			return rcc_get_clock_freq( RCC_CLOCK::AHB );
+		case 0b01:
+			return rcc_get_clock_freq( RCC_CLOCK::PLL1_Q );
+		case 0b10:
+			return rcc_get_clock_freq( RCC_CLOCK::PLL2_R );
+		default:
+			return rcc_get_clock_freq( RCC_CLOCK::PER );
+	}
+}
+
+uint32_t LLPD::rcc_get_core_freq()
+{
+#ifdef CORE_CM4
+	return rcc_get_clock_freq( RCC_CLOCK::AHB );
+#else
+	return rcc_get_clock_freq( RCC_CLOCK::CPU1 );
+#endif
+}
+
+uint32_t LLPD::rcc_clock_change_cpu1 (const RCC_CLOCK_CONFIG& config)
+{
+	if ( ! config.valid )
+	{
+		return 0;
+	}
+
+	// use the cycle counter to measure the switch latency
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	const uint32_t startCycles = DWT->CYCCNT;
+
+	const uint32_t oldCpuFreq = rcc_get_clock_freq( RCC_CLOCK::CPU1 );
+	const uint32_t oldAhbFreq = rcc_get_clock_freq( RCC_CLOCK::AHB );
+	const unsigned int oldVos = getCurrentVos();
+	const unsigned int newVos = getVosForClocks( config.sysFreq, config.ahbFreq );
+
+	// when scaling up, raise the voltage first, it is lowered at the end when scaling down
+	if ( newVos < oldVos )
+	{
+		setVos( newVos );
+	}
+
+	// the flash latency needs to cover the old, new and temporary hsi frequencies at the current voltage
+	const unsigned int switchVos = ( newVos < oldVos ) ? newVos : oldVos;
+	RCC->CR |= RCC_CR_HSION;
+	while ( ! (RCC->CR & RCC_CR_HSIRDY) ) {}
+	const uint32_t hsiFreq = rcc_get_clock_freq( RCC_CLOCK::HSI );
+	uint32_t switchAhbFreq = ( oldAhbFreq > config.ahbFreq ) ? oldAhbFreq : config.ahbFreq;
+	switchAhbFreq = ( hsiFreq > switchAhbFreq ) ? hsiFreq : switchAhbFreq;
+	ensureCorrectFlashLatency( switchAhbFreq, switchVos, true );
+
+	// run from hsi while pll1 is reconfigured (pll1 q and r are also unavailable during this time)
+	RCC->CFGR &= ~(RCC_CFGR_SW);
+	RCC->CFGR |= RCC_CFGR_SW_HSI;
+	while ( (RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI ) {}
+	const uint32_t hsiStartCycles = DWT->CYCCNT;
+
+	startPll( RCC_PLL_NUM::PLL_1, config.pll1 );
+	setBusPrescalers( config );
+
+	// set system clock as pll
+	RCC->CFGR &= ~(RCC_CFGR_SW);
+	RCC->CFGR |= RCC_CFGR_SW_PLL1;
+	while ( (RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL1 ) {}
+	const uint32_t hsiEndCycles = DWT->CYCCNT;
+
+	// set the flash latency for the new frequency at the final voltage, then lower the voltage if scaling down
+	ensureCorrectFlashLatency( config.ahbFreq, newVos );
+	if ( newVos > oldVos )
+	{
+		setVos( newVos );
+	}
+
+	const uint32_t endCycles = DWT->CYCCNT;
+
+	// each part of the switch is counted at the cpu frequency it ran at
+	const uint32_t newCpuFreq = rcc_get_clock_freq( RCC_CLOCK::CPU1 );
+	const uint32_t hsiCpuFreq = hsiFreq / getHpreDiv( (RCC->D1CFGR & RCC_D1CFGR_D1CPRE) >> RCC_D1CFGR_D1CPRE_Pos );
+	const uint64_t latencyNs = ( static_cast<uint64_t>(hsiStartCycles - startCycles) * 1000000000 ) / oldCpuFreq
+					+ ( static_cast<uint64_t>(hsiEndCycles - hsiStartCycles) * 1000000000 ) / hsiCpuFreq
+					+ ( static_cast<uint64_t>(endCycles - hsiEndCycles) * 1000000000 ) / newCpuFreq;
+
+	return static_cast<uint32_t>( latencyNs );
 }
@@ -1,7 +1,5 @@
 #include "LLPD.hpp"
 
-#include <cmath>
-
 // commands
 static constexpr uint32_t SDMMC_CMD_GO_IDLE_STATE = 0;
 static constexpr uint32_t SDMMC_CMD_SEND_OP_COND = 1;
@@ -79,6 +77,8 @@ volatile bool sdmmcTransferCompleted = true;
 volatile bool sdmmcMultiBlockTransfer = false;
 volatile bool sdmmcTransferError = false;
 volatile uint32_t sdmmcTransferErrorStaRegVal = 0;
+uint8_t* volatile sdmmcReadDmaBuffer = nullptr; // invalidated in the d-cache when the read completes
+volatile uint32_t sdmmcReadDmaNumBytes = 0;
 
 static void sendCommand (const uint32_t arg, const uint32_t cmdIndex, const uint32_t response = SDMMC_CMD_NO_RESPONSE,
 				const bool waitForInterrupt = false, const bool waitPend = false, const bool cpsmEnable = true,
@@ -228,11 +228,11 @@ static bool waitForTransferState (uint32_t numBlocks, uint8_t* data = reinterpre
 	return true;
 }
 
-bool LLPD::sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDetectPin, const unsigned int pll2rClkRate, const unsigned int targetSDMMCClkRate,
+bool LLPD::sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDetectPin, const unsigned int targetSDMMCClkRate,
 			const SDMMC_BUS_WIDTH& busWidth, const bool hardwareFlowCtrl, const bool powerSave, const SDMMC_CLK_EDGE& clkEdge)
 {
 	// start sdmmc1 clock
-	RCC->AHB3ENR |= RCC_AHB3ENR_SDMMC1EN;
+	LLPD::periph_enable_clock( PERIPH::SDMMC_1 );
 
 	// start gpio clocks
 	LLPD::gpio_enable_clock( GPIO_PORT::C );
@@ -249,18 +249,18 @@ bool LLPD::sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDete
 	LLPD::gpio_digital_input_setup( cardDetectPort, cardDetectPin, GPIO_PUPD::PULL_UP );
 
 	// reset sdmmc1 registers
-	RCC->AHB3RSTR |= RCC_AHB3RSTR_SDMMC1RST;
-	RCC->AHB3RSTR &= ~(RCC_AHB3RSTR_SDMMC1RST);
+	LLPD::periph_reset( PERIPH::SDMMC_1 );
 
 	// nvic configuration for sdmmc1 interrupts
-	NVIC_SetPriority( SDMMC1_IRQn, 5 );
-	NVIC_EnableIRQ( SDMMC1_IRQn );
+	NVIC_SetPriority( static_cast<IRQn_Type>(periph_desc(PERIPH::SDMMC_1).irqn), 5 );
+	NVIC_EnableIRQ( static_cast<IRQn_Type>(periph_desc(PERIPH::SDMMC_1).irqn) );
 
 	// set signal polarity
 	SDMMC1->POWER |= SDMMC_POWER_DIRPOL;
 
 	// ensure clk rate is <=400kHz for initialization
-	const uint32_t initClkDiv = pll2rClkRate / ( 2 * 400000 );
+	const unsigned int kernelClkRate = LLPD::rcc_get_sdmmc_kernel_freq();
+	const uint32_t initClkDiv = ( kernelClkRate + (2 * 400000) - 1 ) / ( 2 * 400000 );
 
 	// set clock control register (using init values until initialization process is complete)
 	uint32_t ccRegVal = 0;
@@ -271,7 +271,7 @@ bool LLPD::sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDete
 	SDMMC1->POWER |= SDMMC_POWER_PWRCTRL;
 
 	// wait 74 sdmmc clock cycles
-	const unsigned int initSDMMCClkRate = pll2rClkRate / ( 2 * initClkDiv );
+	const unsigned int initSDMMCClkRate = kernelClkRate / ( 2 * initClkDiv );
 	LLPD::tim6_delay( 1 + ((74 * 1000) / initSDMMCClkRate) );
 
 	// send cmd0: go idle state command
@@ -492,7 +492,7 @@ bool LLPD::sdmmc_init (const GPIO_PORT& cardDetectPort, const GPIO_PIN& cardDete
 	}
 
 	// configure sdmmc peripheral to desired parameters
-	uint32_t targetSDMMCClkDiv = std::ceil( static_cast<float>(pll2rClkRate) / (2.0f * static_cast<float>(targetSDMMCClkRate)) );
+	uint32_t targetSDMMCClkDiv = ( kernelClkRate + (2 * targetSDMMCClkRate) - 1 ) / ( 2 * targetSDMMCClkRate );
 	tmpRegVal = SDMMC1->CLKCR;
 	tmpRegVal &= ~(SDMMC_CLKCR_CLKDIV | SDMMC_CLKCR_PWRSAV | SDMMC_CLKCR_WIDBUS | SDMMC_CLKCR_NEGEDGE | SDMMC_CLKCR_HWFC_EN
 			| SDMMC_CLKCR_DDR | SDMMC_CLKCR_BUSSPEED | SDMMC_CLKCR_SELCLKRX);
@@ -575,11 +575,21 @@ bool LLPD::sdmmc_erase (uint32_t address, uint32_t numBlocks)
 
 bool LLPD::sdmmc_read_dma (uint32_t address, uint8_t* data, uint32_t numBlocks)
 {
+	// the lines around an unaligned buffer could be written back over the data the dma writes
+	const uint32_t numBytes = SDMMC_TRANSFER_BLOCK_SIZE * numBlocks;
+	if ( LLPD::cache_dcache_is_enabled() && ! LLPD::cache_range_is_aligned(data, numBytes) )
+	{
+		return false;
+	}
+
 	if ( ! waitForTransferState(numBlocks, data) )
 	{
 		return false;
 	}
 
+	// make sure no dirty lines get evicted over the buffer during the transfer
+	LLPD::cache_invalidate_range( data, numBytes );
+
 	if ( isSdhcOrSdxcCard )
 	{
 		address *= SDMMC_TRANSFER_BLOCK_SIZE;
@@ -629,6 +639,9 @@ bool LLPD::sdmmc_read_dma (uint32_t address, uint8_t* data, uint32_t numBlocks)
 		sdmmcTransferCompleted = false;
 	}
 
+	sdmmcReadDmaBuffer = data;
+	sdmmcReadDmaNumBytes = numBytes;
+
 	// enable interrupts
 	SDMMC1->MASK |= ( SDMMC_MASK_DCRCFAILIE | SDMMC_MASK_DTIMEOUTIE | SDMMC_MASK_RXOVERRIE | SDMMC_MASK_DATAENDIE );
 
@@ -642,6 +655,9 @@ bool LLPD::sdmmc_write_dma (uint32_t address, uint8_t* data, uint32_t numBlocks)
 		return false;
 	}
 
+	// write the buffer back to memory so the dma sends what the cpu wrote
+	LLPD::cache_clean_range( data, SDMMC_TRANSFER_BLOCK_SIZE * numBlocks );
+
 	if ( isSdhcOrSdxcCard )
 	{
 		address *= SDMMC_TRANSFER_BLOCK_SIZE;
@@ -0,0 +1,142 @@
+#include "LLPD.hpp"
+
+static uintptr_t sdramArenaBase = 0;
+static uint32_t sdramArenaSize = 0;
+static volatile uint32_t sdramArenaUsed = 0;
+
+// the arena and pools can be used from isrs, so the few instructions that update them run with interrupts masked
+static inline uint32_t sdramArenaLock()
+{
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	return primask;
+}
+
+static inline void sdramArenaUnlock (const uint32_t primask)
+{
+	__set_PRIMASK( primask );
+}
+
+void LLPD::sdram_arena_init (const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes)
+{
+	sdramArenaBase = fmc_sdram_bank_address( bank );
+	sdramArenaSize = sizeInBytes;
+	sdramArenaUsed = 0;
+}
+
+void* LLPD::sdram_arena_alloc (const uint32_t numBytes, const uint32_t alignment)
+{
+	if ( alignment == 0 || (alignment & (alignment - 1)) != 0 )
+	{
+		return nullptr;
+	}
+
+	const uint32_t primask = sdramArenaLock();
+
+	// the bank address is aligned to far more than any useful alignment, so aligning the offset aligns the address
+	const uint32_t offset = ( sdramArenaUsed + alignment - 1 ) & ~(alignment - 1);
+	if ( offset < sdramArenaUsed || offset > sdramArenaSize || numBytes > sdramArenaSize - offset )
+	{
+		sdramArenaUnlock( primask );
+		return nullptr;
+	}
+
+	sdramArenaUsed = offset + numBytes;
+
+	sdramArenaUnlock( primask );
+
+	return reinterpret_cast<void*>( sdramArenaBase + offset );
+}
+
+uint32_t LLPD::sdram_arena_get_mark()
+{
+	return sdramArenaUsed;
+}
+
+void LLPD::sdram_arena_reset (const uint32_t mark)
+{
+	if ( mark <= sdramArenaUsed )
+	{
+		sdramArenaUsed = mark;
+	}
+}
+
+uint32_t LLPD::sdram_arena_get_free_bytes()
+{
+	return sdramArenaSize - sdramArenaUsed;
+}
+
+bool LLPD::sdram_pool_init (SDRAM_POOL& pool, const uint32_t blockSize, const uint32_t numBlocks, const uint32_t alignment)
+{
+	if ( alignment == 0 || (alignment & (alignment - 1)) != 0 || numBlocks == 0 )
+	{
+		return false;
+	}
+
+	// every block needs room for the free list pointer and has to start on the alignment
+	const uint32_t minBlockSize = ( blockSize < sizeof(uint8_t*) ) ? sizeof(uint8_t*) : blockSize;
+	const uint32_t alignedBlockSize = ( minBlockSize + alignment - 1 ) & ~(alignment - 1);
+	if ( alignedBlockSize < minBlockSize || alignedBlockSize > UINT32_MAX / numBlocks )
+	{
+		return false;
+	}
+
+	uint8_t* firstBlock = static_cast<uint8_t*>( LLPD::sdram_arena_alloc(alignedBlockSize * numBlocks, alignment) );
+	if ( firstBlock == nullptr )
+	{
+		return false;
+	}
+
+	// link every block into the free list, lowest address first
+	for ( uint32_t blockNum = 0; blockNum < numBlocks; blockNum++ )
+	{
+		uint8_t* block = firstBlock + ( blockNum * alignedBlockSize );
+		uint8_t* nextBlock = ( blockNum + 1 < numBlocks ) ? block + alignedBlockSize : nullptr;
+		*reinterpret_cast<uint8_t**>( block ) = nextBlock;
+	}
+
+	pool.firstBlock = firstBlock;
+	pool.freeList = firstBlock;
+	pool.blockSize = alignedBlockSize;
+	pool.numBlocks = numBlocks;
+	pool.numFree = numBlocks;
+
+	return true;
+}
+
+void* LLPD::sdram_pool_alloc (SDRAM_POOL& pool)
+{
+	const uint32_t primask = sdramArenaLock();
+
+	uint8_t* block = pool.freeList;
+	if ( block != nullptr )
+	{
+		pool.freeList = *reinterpret_cast<uint8_t**>( block );
+		pool.numFree--;
+	}
+
+	sdramArenaUnlock( primask );
+
+	return block;
+}
+
+void LLPD::sdram_pool_free (SDRAM_POOL& pool, void* block)
+{
+	uint8_t* blockPtr = static_cast<uint8_t*>( block );
+
+	// ignore pointers that aren't the start of one of this pool's blocks
+	if ( blockPtr < pool.firstBlock || blockPtr >= pool.firstBlock + (pool.blockSize * pool.numBlocks)
+			|| (static_cast<uint32_t>(blockPtr - pool.firstBlock) % pool.blockSize) != 0 )
+	{
+		return;
+	}
+
+	const uint32_t primask = sdramArenaLock();
+
+	*reinterpret_cast<uint8_t**>( blockPtr ) = pool.freeList;
+	pool.freeList = blockPtr;
+	pool.numFree++;
+
+	sdramArenaUnlock( primask );
+}
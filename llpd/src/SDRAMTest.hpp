@@ -0,0 +1,283 @@
+#include "LLPD.hpp"
+
+static constexpr uint32_t SDRAM_TEST_MIN_SIZE_IN_BYTES = 64;
+static constexpr uint32_t SDRAM_TEST_THROUGHPUT_SIZE_IN_BYTES = 1024 * 1024;
+static constexpr uint32_t SDRAM_TEST_PATTERN = 0xAAAAAAAA;
+static constexpr uint32_t SDRAM_TEST_ANTIPATTERN = 0x55555555;
+static constexpr uint64_t SDRAM_TEST_MARCH_BACKGROUND = 0x5555555555555555;
+
+static volatile uint32_t sdramTestSink = 0; // keeps the throughput read loop from being optimized out
+
+static void setSdramTestFailure (SDRAM_TEST_RESULT& result, const SDRAM_TEST_STAGE& stage, volatile uint32_t* address,
+					const uint32_t expected, const uint32_t actual)
+{
+	result.failedStage = stage;
+	result.failAddress = reinterpret_cast<uint32_t>( address );
+	result.expected = expected;
+	result.actual = actual;
+}
+
+// a different value goes onto the bus between each write and read, so a floating data line can't hold the last value
+static bool sdramTestDataBus (volatile uint32_t* words, SDRAM_TEST_RESULT& result)
+{
+	for ( uint32_t bit = 0; bit < 32; bit++ )
+	{
+		const uint32_t pattern = 1UL << bit;
+		words[0] = pattern;
+		words[1] = ~pattern;
+
+		const uint32_t actual = words[0];
+		if ( actual != pattern )
+		{
+			setSdramTestFailure( result, SDRAM_TEST_STAGE::DATA_BUS, &words[0], pattern, actual );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// every address line is toggled on its own, which catches lines stuck high, stuck low or shorted together
+static bool sdramTestAddressBus (volatile uint32_t* words, const uint32_t numWords, SDRAM_TEST_RESULT& result)
+{
+	for ( uint32_t offset = 1; offset < numWords; offset <<= 1 )
+	{
+		words[offset] = SDRAM_TEST_PATTERN;
+	}
+
+	words[0] = SDRAM_TEST_ANTIPATTERN;
+	for ( uint32_t offset = 1; offset < numWords; offset <<= 1 )
+	{
+		const uint32_t actual = words[offset];
+		if ( actual != SDRAM_TEST_PATTERN )
+		{
+			setSdramTestFailure( result, SDRAM_TEST_STAGE::ADDRESS_BUS, &words[offset], SDRAM_TEST_PATTERN, actual );
+			return false;
+		}
+	}
+	words[0] = SDRAM_TEST_PATTERN;
+
+	for ( uint32_t testOffset = 1; testOffset < numWords; testOffset <<= 1 )
+	{
+		words[testOffset] = SDRAM_TEST_ANTIPATTERN;
+
+		for ( uint32_t offset = 0; offset < numWords; offset = (offset == 0) ? 1 : offset << 1 )
+		{
+			const uint32_t actual = words[offset];
+			if ( offset != testOffset && actual != SDRAM_TEST_PATTERN )
+			{
+				setSdramTestFailure( result, SDRAM_TEST_STAGE::ADDRESS_BUS, &words[offset], SDRAM_TEST_PATTERN, actual );
+				return false;
+			}
+		}
+
+		words[testOffset] = SDRAM_TEST_PATTERN;
+	}
+
+	return true;
+}
+
+// one march element, reading the expected value from each 64 bit word then writing the new one
+static bool sdramTestMarchElement (volatile uint64_t* dwords, const uint32_t numDwords, const bool ascending, const bool read,
+					const uint64_t readVal, const bool write, const uint64_t writeVal, SDRAM_TEST_RESULT& result)
+{
+	for ( uint32_t count = 0; count < numDwords; count++ )
+	{
+		const uint32_t index = ascending ? count : numDwords - 1 - count;
+
+		if ( read )
+		{
+			const uint64_t actual = dwords[index];
+			if ( actual != readVal )
+			{
+				// report the 32 bit half that's wrong
+				volatile uint32_t* address = reinterpret_cast<volatile uint32_t*>( &dwords[index] );
+				const bool lowIsWrong = static_cast<uint32_t>( actual ) != static_cast<uint32_t>( readVal );
+				setSdramTestFailure( result, SDRAM_TEST_STAGE::MARCH, lowIsWrong ? address : address + 1,
+							static_cast<uint32_t>(readVal >> (lowIsWrong ? 0 : 32)),
+							static_cast<uint32_t>(actual >> (lowIsWrong ? 0 : 32)) );
+				return false;
+			}
+		}
+
+		if ( write )
+		{
+			dwords[index] = writeVal;
+		}
+	}
+
+	return true;
+}
+
+// march c-, with a checkerboard background so neighbouring bits always hold opposite values
+static bool sdramTestMarch (volatile uint64_t* dwords, const uint32_t numDwords, SDRAM_TEST_RESULT& result)
+{
+	const uint64_t zero = SDRAM_TEST_MARCH_BACKGROUND;
+	const uint64_t one = ~SDRAM_TEST_MARCH_BACKGROUND;
+
+	return sdramTestMarchElement( dwords, numDwords, true, false, 0, true, zero, result )
+		&& sdramTestMarchElement( dwords, numDwords, true, true, zero, true, one, result )
+		&& sdramTestMarchElement( dwords, numDwords, true, true, one, true, zero, result )
+		&& sdramTestMarchElement( dwords, numDwords, false, true, zero, true, one, result )
+		&& sdramTestMarchElement( dwords, numDwords, false, true, one, true, zero, result )
+		&& sdramTestMarchElement( dwords, numDwords, true, true, zero, false, 0, result );
+}
+
+static void sdramTestThroughput (volatile uint64_t* dwords, const uint32_t numDwords, SDRAM_TEST_RESULT& result)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t startCycles = DWT->CYCCNT;
+	for ( uint32_t index = 0; index < numDwords; index += 4 )
+	{
+		dwords[index] = index;
+		dwords[index + 1] = index;
+		dwords[index + 2] = index;
+		dwords[index + 3] = index;
+	}
+	__DSB();
+	const uint32_t writeCycles = DWT->CYCCNT - startCycles;
+
+	startCycles = DWT->CYCCNT;
+	uint64_t sum = 0;
+	for ( uint32_t index = 0; index < numDwords; index += 4 )
+	{
+		sum += dwords[index] + dwords[index + 1] + dwords[index + 2] + dwords[index + 3];
+	}
+	const uint32_t readCycles = DWT->CYCCNT - startCycles;
+	sdramTestSink = static_cast<uint32_t>( sum );
+
+	__set_PRIMASK( primask );
+
+	const uint64_t numBytes = static_cast<uint64_t>( numDwords ) * sizeof(uint64_t);
+	const uint32_t coreFreq = LLPD::rcc_get_core_freq();
+	result.writeMBps = mem_bandwidth_MBps( numBytes, writeCycles, coreFreq );
+	result.readMBps = mem_bandwidth_MBps( numBytes, readCycles, coreFreq );
+}
+
+SDRAM_TEST_RESULT LLPD::sdram_test_run (const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes)
+{
+	SDRAM_TEST_RESULT result;
+
+	// the floor comes from what the fmc is actually programmed with, burst read and read pipe delay are only in sdcr1
+	const uint32_t sdcr = FMC_Bank5_6_R->SDCR[static_cast<uint32_t>( bank )];
+	const uint32_t sdcr1 = FMC_Bank5_6_R->SDCR[0];
+	const FMC_SDRAM_DATA_ADDR_BITS dataBits = static_cast<FMC_SDRAM_DATA_ADDR_BITS>( (sdcr & FMC_SDCRx_MWID) >> FMC_SDCRx_MWID_Pos );
+	const FMC_SDRAM_CAS_LATENCY casLatency = static_cast<FMC_SDRAM_CAS_LATENCY>( (sdcr & FMC_SDCRx_CAS) >> FMC_SDCRx_CAS_Pos );
+	const FMC_SDRAM_RPIPE_DELAY rPipeDelay = static_cast<FMC_SDRAM_RPIPE_DELAY>( (sdcr1 & FMC_SDCRx_RPIPE) >> FMC_SDCRx_RPIPE_Pos );
+	const bool burstRead = sdcr1 & FMC_SDCRx_RBURST;
+	const uint32_t sdclkFreq = LLPD::fmc_sdram_get_clock_freq();
+
+	result.minWriteMBps = fmc_sdram_min_write_MBps( sdclkFreq, dataBits );
+	result.minReadMBps = fmc_sdram_min_read_MBps( sdclkFreq, dataBits, casLatency, burstRead, rPipeDelay );
+
+	volatile uint32_t* words = reinterpret_cast<volatile uint32_t*>( fmc_sdram_bank_address(bank) );
+	if ( sizeInBytes < SDRAM_TEST_MIN_SIZE_IN_BYTES )
+	{
+		setSdramTestFailure( result, SDRAM_TEST_STAGE::DATA_BUS, words, sizeInBytes, 0 );
+		return result;
+	}
+
+	const uint32_t numDwords = ( sizeInBytes / SDRAM_TEST_MIN_SIZE_IN_BYTES ) * ( SDRAM_TEST_MIN_SIZE_IN_BYTES / sizeof(uint64_t) );
+	const uint32_t numThroughputBytes = ( sizeInBytes < SDRAM_TEST_THROUGHPUT_SIZE_IN_BYTES ) ? numDwords * sizeof(uint64_t)
+													: SDRAM_TEST_THROUGHPUT_SIZE_IN_BYTES;
+	volatile uint64_t* dwords = reinterpret_cast<volatile uint64_t*>( words );
+
+#ifndef CORE_CM4
+	// every access has to reach the sdram, and the throughput floor assumes uncached accesses. Disabling cleans the d-cache first
+	const bool dcacheWasEnabled = LLPD::cache_dcache_is_enabled();
+	SCB_DisableDCache();
+#endif
+
+	if ( sdramTestDataBus(words, result) && sdramTestAddressBus(words, sizeInBytes / sizeof(uint32_t), result)
+			&& sdramTestMarch(dwords, numDwords, result) )
+	{
+		sdramTestThroughput( dwords, numThroughputBytes / sizeof(uint64_t), result );
+
+		if ( result.writeMBps < result.minWriteMBps )
+		{
+			setSdramTestFailure( result, SDRAM_TEST_STAGE::THROUGHPUT, words, result.minWriteMBps, result.writeMBps );
+		}
+		else if ( result.readMBps < result.minReadMBps )
+		{
+			setSdramTestFailure( result, SDRAM_TEST_STAGE::THROUGHPUT, words, result.minReadMBps, result.readMBps );
+		}
+	}
+
+#ifndef CORE_CM4
+	if ( dcacheWasEnabled )
+	{
+		SCB_EnableDCache();
+	}
+#endif
+
+	return result;
+}
+
+static const char* getSdramTestStageName (const SDRAM_TEST_STAGE& stage)
+{
+	switch ( stage )
+	{
+		case SDRAM_TEST_STAGE::NONE:
+			return "none";
+		case SDRAM_TEST_STAGE::DATA_BUS:
+			return "data bus";
+		case SDRAM_TEST_STAGE::ADDRESS_BUS:
+			return "address bus";
+		case SDRAM_TEST_STAGE::MARCH:
+			return "march";
+		case SDRAM_TEST_STAGE::THROUGHPUT:
+			return "throughput";
+	}
+
+	return "unknown";
+}
+
+static void logSdramTestFailure (const USART_NUM& usartNum, const SDRAM_TEST_RESULT& result)
+{
+	LLPD::usart_log( usartNum, "SDRAM SELF-CHECK FAILED" );
+	LLPD::usart_log( usartNum, getSdramTestStageName(result.failedStage) );
+	LLPD::usart_log_hex( usartNum, "    address: ", result.failAddress );
+	LLPD::usart_log_hex( usartNum, "    expected: ", result.expected );
+	LLPD::usart_log_hex( usartNum, "    actual: ", result.actual );
+}
+
+bool LLPD::sdram_test_log (const USART_NUM& usartNum, const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes, const bool haltOnFailure)
+{
+	LLPD::usart_log( usartNum, "sdram self-check" );
+	LLPD::usart_log_hex( usartNum, "    base address: ", fmc_sdram_bank_address(bank) );
+	LLPD::usart_log_int( usartNum, "    size: ", sizeInBytes );
+
+	const SDRAM_TEST_RESULT result = LLPD::sdram_test_run( bank, sizeInBytes );
+
+	LLPD::usart_log_int( usartNum, "    write MB/s: ", result.writeMBps );
+	LLPD::usart_log_int( usartNum, "    min write MB/s: ", result.minWriteMBps );
+	LLPD::usart_log_int( usartNum, "    read MB/s: ", result.readMBps );
+	LLPD::usart_log_int( usartNum, "    min read MB/s: ", result.minReadMBps );
+
+	if ( result.failedStage == SDRAM_TEST_STAGE::NONE )
+	{
+		LLPD::usart_log( usartNum, "    passed" );
+		return true;
+	}
+
+	logSdramTestFailure( usartNum, result );
+
+	// the timers may not be set up yet, so the failure is repeated about once a second by counting core cycles
+	while ( haltOnFailure )
+	{
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+		const uint32_t startCycles = DWT->CYCCNT;
+		while ( DWT->CYCCNT - startCycles < LLPD::rcc_get_core_freq() ) {}
+
+		logSdramTestFailure( usartNum, result );
+	}
+
+	return false;
+}
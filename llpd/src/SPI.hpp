@@ -1,71 +1,19 @@
 #include "LLPD.hpp"
 
-static void setup_spi_registers (SPI_TypeDef* spiPtr, const SPI_BAUD_RATE& baudRate, const SPI_CLK_POL& pol,
+static void setup_spi_registers (const PERIPH& periph, SPI_TypeDef* spiPtr, const SPI_BAUD_RATE& baudRate, const SPI_CLK_POL& pol,
 				const SPI_CLK_PHASE& phase, const SPI_DUPLEX& duplex, const SPI_FRAME_FORMAT& frameFormat,
 				const SPI_DATA_SIZE& dataSize)
 {
 	if ( spiPtr )
 	{
 		// enable spi peripheral clock
-		if ( spiPtr == SPI1 )
-		{
-			RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
-		}
-		else if ( spiPtr == SPI2 )
-		{
-			RCC->APB1LENR |= RCC_APB1LENR_SPI2EN;
-		}
-		else if ( spiPtr == SPI3 )
-		{
-			RCC->APB1LENR |= RCC_APB1LENR_SPI3EN;
-		}
-		else if ( spiPtr == SPI4 )
-		{
-			RCC->APB2ENR |= RCC_APB2ENR_SPI4EN;
-		}
-		else if ( spiPtr == SPI5 )
-		{
-			RCC->APB2ENR |= RCC_APB2ENR_SPI5EN;
-		}
-		else if ( spiPtr == SPI6 )
-		{
-			RCC->APB2ENR |= RCC_APB4ENR_SPI6EN;
-		}
+		LLPD::periph_enable_clock( periph );
 
 		// ensure spi is off
 		spiPtr->CR1 &= ~(SPI_CR1_SPE);
 
 		// reset registers
-		if ( spiPtr == SPI1 )
-		{
-			RCC->APB2RSTR |= RCC_APB2RSTR_SPI1RST;
-			RCC->APB2RSTR &= ~(RCC_APB2RSTR_SPI1RST);
-		}
-		else if ( spiPtr == SPI2 )
-		{
-			RCC->APB1LRSTR |= RCC_APB1LRSTR_SPI2RST;
-			RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_SPI2RST);
-		}
-		else if ( spiPtr == SPI3 )
-		{
-			RCC->APB1LRSTR |= RCC_APB1LRSTR_SPI3RST;
-			RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_SPI3RST);
-		}
-		else if ( spiPtr == SPI4 )
-		{
-			RCC->APB2RSTR |= RCC_APB2RSTR_SPI4RST;
-			RCC->APB2RSTR &= ~(RCC_APB2RSTR_SPI4RST);
-		}
-		else if ( spiPtr == SPI5 )
-		{
-			RCC->APB2RSTR |= RCC_APB2RSTR_SPI5RST;
-			RCC->APB2RSTR &= ~(RCC_APB2RSTR_SPI5RST);
-		}
-		else if ( spiPtr == SPI6 )
-		{
-			RCC->APB4RSTR |= RCC_APB4RSTR_SPI6RST;
-			RCC->APB4RSTR &= ~(RCC_APB4RSTR_SPI6RST);
-		}
+		LLPD::periph_reset( periph );
 
 		// set baud rate
 		if ( baudRate == SPI_BAUD_RATE::SYSCLK_DIV_BY_2 )
@@ -369,7 +317,7 @@ void LLPD::spi_master_init (const SPI_NUM& spiNum, const SPI_BAUD_RATE& baudRate
 	// set sck low
 	LLPD::gpio_output_set( gpioPort, sckPin, false );
 
-	setup_spi_registers( spiPtr, baudRate, pol, phase, duplex, frameFormat, dataSize );
+	setup_spi_registers( periph_from_spi(spiNum), spiPtr, baudRate, pol, phase, duplex, frameFormat, dataSize );
 }
 
 uint16_t LLPD::spi_master_send_and_recieve (const SPI_NUM& spiNum, uint8_t data)
@@ -503,3 +451,17 @@ void LLPD::spi_master_change_baud_rate (const SPI_NUM& spiNum, const SPI_BAUD_RA
 	// lastly, enable SPI peripheral
 	spiPtr->CR1 |= SPI_CR1_SPE;
 }
+
+SPI_BAUD_RATE LLPD::spi_get_baud_rate (const SPI_NUM& spiNum, const uint32_t maxBaudRate)
+{
+	const uint32_t kernelClockFreq = LLPD::rcc_get_spi_kernel_freq( spiNum );
+
+	// the baud rate enum values are in order of divide by 2, 4, 8 ... 256
+	unsigned int divIndex = 0;
+	while ( divIndex < static_cast<unsigned int>(SPI_BAUD_RATE::SYSCLK_DIV_BY_256) && (kernelClockFreq >> (divIndex + 1)) > maxBaudRate )
+	{
+		divIndex++;
+	}
+
+	return static_cast<SPI_BAUD_RATE>( divIndex );
+}
@@ -0,0 +1,24 @@
+#include "LLPD.hpp"
+
+void LLPD::sram_layout_log (const USART_NUM& usartNum)
+{
+	const SRAM_REGION regions[2] = { SRAM_REGION::D2_SHARED, SRAM_REGION::D3 };
+	for ( const SRAM_REGION& region : regions )
+	{
+		LLPD::usart_log( usartNum, (region == SRAM_REGION::D3) ? "d3 sram" : "d2 shared sram" );
+		LLPD::usart_log_hex( usartNum, "base address: ", sram_region_base(region) );
+		LLPD::usart_log_int( usartNum, "used bytes: ", sram_region_used_bytes(region) );
+		LLPD::usart_log_int( usartNum, "free bytes: ", sram_region_size(region) - sram_region_used_bytes(region) );
+
+		for ( unsigned int index = 0; index < NUM_SRAM_SLOTS; index++ )
+		{
+			const SRAM_SLOT_DESC& desc = SRAM_SLOT_DESCS[index];
+			if ( desc.region == region )
+			{
+				LLPD::usart_log( usartNum, desc.name );
+				LLPD::usart_log_hex( usartNum, "    address: ", sram_slot_address(desc.slot) );
+				LLPD::usart_log_int( usartNum, "    size: ", desc.sizeInBytes );
+			}
+		}
+	}
+}
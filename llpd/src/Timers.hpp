@@ -3,30 +3,56 @@
 #include <limits>
 
 static volatile bool      tim6InterruptsEnabled = false;
-static volatile float*    tim6DelayVal = (float*) D3_SRAM_BASE; // value for delay functions
+static volatile float*    tim6DelayVal = reinterpret_cast<float*>( sram_slot_address(SRAM_SLOT::TIM6_DELAY) ); // value for delay functions
 static volatile uint32_t  tim6InterruptRate = 0; 	// interrupt rate used for delay functions
 static volatile float*    tim6USecondMax = tim6DelayVal + 1; 	// when tim6USecondIncr reaches this value, the delay is over
 static volatile float*    tim6USecondIncr = tim6USecondMax + 1;	// how much to increment per interrupt for microsecond delay
 static volatile uint32_t* tim6CyclesPerInterrupt = reinterpret_cast<volatile uint32_t*>( tim6USecondIncr + 1 );
 
-void LLPD::tim6_counter_setup (uint32_t prescalerDivisor, uint32_t cyclesPerInterrupt, uint32_t interruptRate)
+void LLPD::tim6_counter_setup (uint32_t interruptRate)
 {
+	if ( interruptRate == 0 )
+	{
+		return;
+	}
+
+	// the auto-reload value has to be at least 1, so the period needs at least 2 timer cycles
+	const uint32_t cyclesPerPeriod = LLPD::rcc_get_clock_freq( RCC_CLOCK::APB1_TIMER ) / interruptRate;
+	if ( cyclesPerPeriod < 2 )
+	{
+		return;
+	}
+
+	// pick the smallest prescaler that lets the auto-reload value fit in 16 bits
+	const uint32_t prescalerDivisor = ( cyclesPerPeriod - 1 ) / 65536;
+	const uint32_t cyclesPerInterrupt = cyclesPerPeriod / ( prescalerDivisor + 1 );
+
+	LLPD::tim6_counter_setup( prescalerDivisor, cyclesPerInterrupt - 1 );
+}
+
+void LLPD::tim6_counter_setup (uint32_t prescalerDivisor, uint32_t cyclesPerInterrupt)
+{
+	// an auto-reload value of 0 stops the counter, and the delay functions divide by it
+	if ( cyclesPerInterrupt == 0 )
+	{
+		return;
+	}
+
 	*tim6DelayVal = std::numeric_limits<float>::max();
 
-	// store sample rate for delay functions
+	// store sample rate for delay functions, derived from the current timer kernel clock
 	*tim6CyclesPerInterrupt = cyclesPerInterrupt;
-	tim6InterruptRate = interruptRate;
+	tim6InterruptRate = LLPD::rcc_get_clock_freq( RCC_CLOCK::APB1_TIMER ) / ( (prescalerDivisor + 1) * (cyclesPerInterrupt + 1) );
 	*tim6USecondIncr = 1000000.0f / tim6InterruptRate;
 
 	// make sure timer is disabled during setup
 	TIM6->CR1 &= ~(TIM_CR1_CEN);
 
 	// enable peripheral clock to TIM6
-	RCC->APB1LENR |= RCC_APB1LENR_TIM6EN;
+	LLPD::periph_enable_clock( PERIPH::TIM_6 );
 
 	// reset registers
-	RCC->APB1LRSTR |= RCC_APB1LRSTR_TIM6RST;
-	RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_TIM6RST);
+	LLPD::periph_reset( PERIPH::TIM_6 );
 
 	// set timer prescaler and auto-reload values
 	TIM6->PSC = prescalerDivisor;
@@ -76,7 +102,7 @@ void LLPD::tim6_counter_stop()
 	TIM6->SR  &= ~(TIM_SR_UIF);
 }
 
-void LLPD::tim6_counter_clear_interrupt_flag()
+LLPD_ITCM_FUNC void LLPD::tim6_counter_clear_interrupt_flag()
 {
 	TIM6->SR &= ~(TIM_SR_UIF);
 }
@@ -112,7 +138,7 @@ void LLPD::tim6_delay (uint32_t microseconds)
 	}
 }
 
-bool LLPD::tim6_isr_handle_delay()
+LLPD_ITCM_FUNC bool LLPD::tim6_isr_handle_delay()
 {
 	if ( *tim6DelayVal < *tim6USecondMax )
 	{
@@ -128,3 +154,48 @@ float LLPD::tim6_get_usecond_incr()
 {
 	return *tim6USecondIncr;
 }
+
+uint32_t LLPD::tim15_trigger_setup (uint32_t triggerRate)
+{
+	if ( triggerRate == 0 )
+	{
+		return 0;
+	}
+
+	// pick the smallest prescaler that lets the auto-reload value fit in 16 bits, so the rate is as close as possible
+	const uint32_t timerClockFreq = LLPD::rcc_get_clock_freq( RCC_CLOCK::APB2_TIMER );
+	const uint32_t cyclesPerPeriod = timerClockFreq / triggerRate;
+	const uint32_t prescalerDivisor = ( cyclesPerPeriod > 0 ) ? ( cyclesPerPeriod - 1 ) / 65536 : 0;
+	const uint32_t cyclesPerTrigger = cyclesPerPeriod / ( prescalerDivisor + 1 );
+	const uint32_t autoReload = ( cyclesPerTrigger > 0 ) ? cyclesPerTrigger - 1 : 0;
+
+	// enable peripheral clock to TIM15 and reset registers, which also leaves the timer disabled
+	LLPD::periph_enable_clock( PERIPH::TIM_15 );
+	LLPD::periph_reset( PERIPH::TIM_15 );
+
+	// set timer prescaler and auto-reload values
+	TIM15->PSC = prescalerDivisor;
+	TIM15->ARR = autoReload;
+
+	// send an update event to apply the settings
+	TIM15->EGR |= TIM_EGR_UG;
+
+	// set master mode to update
+	TIM15->CR2 = TIM_CR2_MMS_1;
+
+	// clear update status
+	TIM15->SR = 0;
+
+	return timerClockFreq / ( (prescalerDivisor + 1) * (autoReload + 1) );
+}
+
+void LLPD::tim15_trigger_start()
+{
+	TIM15->CR1 |= TIM_CR1_CEN;
+}
+
+void LLPD::tim15_trigger_stop()
+{
+	TIM15->CR1 &= ~(TIM_CR1_CEN);
+	TIM15->SR &= ~(TIM_SR_UIF);
+}
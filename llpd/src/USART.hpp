@@ -8,17 +8,14 @@ static uint16_t usart3WordLenMask = 0b0000000011111111;
 static uint16_t usart6WordLenMask = 0b0000000011111111;
 
 void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordLen, const USART_PARITY& parity,
-			const USART_CONF& conf, const USART_STOP_BITS& stopBits, const unsigned int periphClockFreq,
-			const unsigned int baudRate)
+			const USART_CONF& conf, const USART_STOP_BITS& stopBits, const unsigned int baudRate)
 {
+	const PERIPH periph = periph_from_usart( usartNum );
 	USART_TypeDef* usart = nullptr;
 	uint16_t* usartWordLenMask = nullptr;
 
 	if ( usartNum == USART_NUM::USART_1 )
 	{
-		// enable usart peripheral clock
-		RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
-
 		usart = USART1;
 		usartWordLenMask = &usart1WordLenMask;
 
@@ -37,9 +34,6 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 	}
 	else if ( usartNum == USART_NUM::USART_2 )
 	{
-		// enable usart peripheral clock
-		RCC->APB1LENR |= RCC_APB1LENR_USART2EN;
-
 		usart = USART2;
 		usartWordLenMask = &usart2WordLenMask;
 
@@ -58,9 +52,6 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 	}
 	else if ( usartNum == USART_NUM::USART_3 )
 	{
-		// enable usart peripheral clock
-		RCC->APB1LENR |= RCC_APB1LENR_USART3EN;
-
 		usart = USART3;
 		usartWordLenMask = &usart3WordLenMask;
 
@@ -79,9 +70,6 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 	}
 	else if ( usartNum == USART_NUM::USART_6 )
 	{
-		// enable usart peripheral clock
-		RCC->APB2ENR |= RCC_APB2ENR_USART6EN;
-
 		usart = USART6;
 		usartWordLenMask = &usart6WordLenMask;
 
@@ -101,6 +89,9 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 
 	if ( usart && usartWordLenMask )
 	{
+		// enable usart peripheral clock
+		LLPD::periph_enable_clock( periph );
+
 		// ensure usart is off
 		usart->CR1 &= ~(USART_CR1_UE);
 
@@ -108,26 +99,7 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 		usart->CR1 &= ~(USART_CR1_FIFOEN);
 
 		// reset registers
-		if ( usartNum == USART_NUM::USART_1 )
-		{
-			RCC->APB2RSTR |= RCC_APB2RSTR_USART1RST;
-			RCC->APB2RSTR &= ~(RCC_APB2RSTR_USART1RST);
-		}
-		else if ( usartNum == USART_NUM::USART_2 )
-		{
-			RCC->APB1LRSTR |= RCC_APB1LRSTR_USART2RST;
-			RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_USART2RST);
-		}
-		else if ( usartNum == USART_NUM::USART_3 )
-		{
-			RCC->APB1LRSTR |= RCC_APB1LRSTR_USART3RST;
-			RCC->APB1LRSTR &= ~(RCC_APB1LRSTR_USART3RST);
-		}
-		else if ( usartNum == USART_NUM::USART_6 )
-		{
-			RCC->APB2RSTR |= RCC_APB2RSTR_USART6RST;
-			RCC->APB2RSTR &= ~(RCC_APB2RSTR_USART6RST);
-		}
+		LLPD::periph_reset( periph );
 
 		// set word length
 		if ( wordLen == USART_WORD_LENGTH::BITS_7 )
@@ -200,8 +172,9 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 			usart->CR2 |= USART_CR2_STOP_1;
 		}
 
-		// set baud rate
-		uint16_t usartDiv = periphClockFreq / baudRate;
+		// set baud rate (rounded to the closest divider) from the current kernel clock
+		const uint32_t kernelClockFreq = LLPD::rcc_get_usart_kernel_freq( usartNum );
+		uint16_t usartDiv = ( kernelClockFreq + (baudRate / 2) ) / baudRate;
 		usart->BRR = usartDiv;
 
 		if ( usingReceiver )
@@ -210,26 +183,9 @@ void LLPD::usart_init (const USART_NUM& usartNum, const USART_WORD_LENGTH& wordL
 			usart->CR1 |= USART_CR1_RXNEIE;
 
 			// enable interrupt service routine with priority behind audio timer
-			if ( usartNum == USART_NUM::USART_1 )
-			{
-				NVIC_SetPriority( USART1_IRQn, 0x01 );
-				NVIC_EnableIRQ( USART1_IRQn );
-			}
-			else if ( usartNum == USART_NUM::USART_2 )
-			{
-				NVIC_SetPriority( USART2_IRQn, 0x01 );
-				NVIC_EnableIRQ( USART2_IRQn );
-			}
-			else if ( usartNum == USART_NUM::USART_3 )
-			{
-				NVIC_SetPriority( USART3_IRQn, 0x01 );
-				NVIC_EnableIRQ( USART3_IRQn );
-			}
-			else if ( usartNum == USART_NUM::USART_6 )
-			{
-				NVIC_SetPriority( USART6_IRQn, 0x01 );
-				NVIC_EnableIRQ( USART6_IRQn );
-			}
+			const IRQn_Type irqn = static_cast<IRQn_Type>( periph_desc(periph).irqn );
+			NVIC_SetPriority( irqn, 0x01 );
+			NVIC_EnableIRQ( irqn );
 		}
 		else // not using reciever
 		{
@@ -393,3 +349,22 @@ void LLPD::usart_log_float (const USART_NUM& usartNum, const char* cStr, float v
 
 	LLPD::usart_transmit( usartNum, '\n' );
 }
+
+void LLPD::usart_log_hex (const USART_NUM& usartNum, const char* cStr, uint32_t val)
+{
+	while ( *cStr )
+	{
+		LLPD::usart_transmit( usartNum, *cStr );
+		cStr++;
+	}
+
+	LLPD::usart_transmit( usartNum, '0' );
+	LLPD::usart_transmit( usartNum, 'x' );
+	for ( int shift = 28; shift >= 0; shift -= 4 )
+	{
+		const uint32_t nibble = ( val >> shift ) & 0xF;
+		LLPD::usart_transmit( usartNum, (nibble < 10) ? '0' + nibble : 'A' + (nibble - 10) );
+	}
+
+	LLPD::usart_transmit( usartNum, '\n' );
+}
@@ -0,0 +1,261 @@
+// host tests for the sdram arena and pools, with the banks pointed at heap buffers
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/SDRAMArena.hpp"
+
+uint32_t testPrimask = 0;
+unsigned int testNumIrqDisables = 0;
+uintptr_t testSdramBankAddresses[2] = { 0, 0 };
+
+static constexpr uint32_t TEST_BANK_ALIGNMENT = 4096; // stands in for the fmc bank addresses, which are far more aligned
+static constexpr uint32_t TEST_ARENA_SIZE = 64 * 1024;
+
+static unsigned int numFailures = 0;
+
+#define CHECK( cond ) \
+	do \
+	{ \
+		if ( !(cond) ) \
+		{ \
+			printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); \
+			numFailures++; \
+		} \
+	} while ( 0 )
+
+static uint8_t* testBuffer = nullptr;
+
+static void resetArena (const uint32_t sizeInBytes = TEST_ARENA_SIZE)
+{
+	LLPD::sdram_arena_init( FMC_SDRAM_BANK::BANK_5, sizeInBytes );
+}
+
+static uint32_t offsetOf (const void* ptr)
+{
+	return static_cast<uint32_t>( static_cast<const uint8_t*>(ptr) - testBuffer );
+}
+
+static void testAlignment()
+{
+	resetArena();
+
+	// the default alignment rounds up to 4 bytes
+	void* first = LLPD::sdram_arena_alloc( 1 );
+	void* second = LLPD::sdram_arena_alloc( 1 );
+	CHECK( first != nullptr && offsetOf(first) == 0 );
+	CHECK( second != nullptr && offsetOf(second) == SDRAM_ARENA_MIN_ALIGNMENT );
+
+	void* aligned = LLPD::sdram_arena_alloc( 8, 64 );
+	CHECK( aligned != nullptr && offsetOf(aligned) == 64 );
+	CHECK( reinterpret_cast<uintptr_t>(aligned) % 64 == 0 );
+	CHECK( LLPD::sdram_arena_get_mark() == 72 );
+
+	// an already aligned offset isn't moved
+	void* unmoved = LLPD::sdram_arena_alloc( 4, 8 );
+	CHECK( unmoved != nullptr && offsetOf(unmoved) == 72 );
+
+	// alignments that aren't powers of 2 are rejected without using any memory
+	const uint32_t badAlignments[4] = { 0, 3, 12, 0x80000001 };
+	for ( const uint32_t alignment : badAlignments )
+	{
+		CHECK( LLPD::sdram_arena_alloc(4, alignment) == nullptr );
+	}
+	CHECK( LLPD::sdram_arena_get_mark() == 76 );
+}
+
+static void testExhaustion()
+{
+	resetArena( 1024 );
+
+	CHECK( LLPD::sdram_arena_alloc(1000, 1) != nullptr );
+	CHECK( LLPD::sdram_arena_get_free_bytes() == 24 );
+
+	// one byte too many fails and leaves the arena alone
+	CHECK( LLPD::sdram_arena_alloc(25, 1) == nullptr );
+	CHECK( LLPD::sdram_arena_get_free_bytes() == 24 );
+
+	// exactly the remaining bytes succeeds
+	void* last = LLPD::sdram_arena_alloc( 24, 1 );
+	CHECK( last != nullptr && offsetOf(last) == 1000 );
+	CHECK( LLPD::sdram_arena_get_free_bytes() == 0 );
+	CHECK( LLPD::sdram_arena_alloc(1, 1) == nullptr );
+
+	// sizes that would wrap numBytes + offset are rejected
+	resetArena( 1024 );
+	CHECK( LLPD::sdram_arena_alloc(16, 1) != nullptr );
+	CHECK( LLPD::sdram_arena_alloc(UINT32_MAX, 1) == nullptr );
+	CHECK( LLPD::sdram_arena_alloc(UINT32_MAX - 8, 1) == nullptr );
+	CHECK( LLPD::sdram_arena_get_mark() == 16 );
+
+	// an alignment that pushes the offset past the end is rejected
+	CHECK( LLPD::sdram_arena_alloc(1, 2048) == nullptr );
+	CHECK( LLPD::sdram_arena_get_mark() == 16 );
+
+	// an alignment that wraps the offset around to 0 is rejected (the arena never touches the memory, so a 4 GB size is fine)
+	resetArena( UINT32_MAX );
+	CHECK( LLPD::sdram_arena_alloc(UINT32_MAX - 2, 1) != nullptr );
+	CHECK( LLPD::sdram_arena_alloc(1, 16) == nullptr );
+	CHECK( LLPD::sdram_arena_get_mark() == UINT32_MAX - 2 );
+}
+
+static void testMarkAndReset()
+{
+	resetArena();
+
+	CHECK( LLPD::sdram_arena_alloc(100) != nullptr );
+	const uint32_t mark = LLPD::sdram_arena_get_mark();
+	CHECK( mark == 100 );
+
+	void* frameAlloc = LLPD::sdram_arena_alloc( 200 );
+	CHECK( frameAlloc != nullptr );
+
+	// resetting to the mark hands out the same memory again
+	LLPD::sdram_arena_reset( mark );
+	CHECK( LLPD::sdram_arena_get_mark() == mark );
+	CHECK( LLPD::sdram_arena_alloc(200) == frameAlloc );
+
+	// a mark beyond the used bytes is ignored instead of growing the arena
+	const uint32_t used = LLPD::sdram_arena_get_mark();
+	LLPD::sdram_arena_reset( used + 4 );
+	CHECK( LLPD::sdram_arena_get_mark() == used );
+	LLPD::sdram_arena_reset( TEST_ARENA_SIZE * 2 );
+	CHECK( LLPD::sdram_arena_get_mark() == used );
+
+	// the default resets everything
+	LLPD::sdram_arena_reset();
+	CHECK( LLPD::sdram_arena_get_mark() == 0 );
+	CHECK( LLPD::sdram_arena_get_free_bytes() == TEST_ARENA_SIZE );
+}
+
+static void testPool()
+{
+	resetArena();
+
+	// bad alignments and empty pools are rejected
+	SDRAM_POOL badPool;
+	CHECK( !LLPD::sdram_pool_init(badPool, 16, 4, 0) );
+	CHECK( !LLPD::sdram_pool_init(badPool, 16, 4, 24) );
+	CHECK( !LLPD::sdram_pool_init(badPool, 16, 0, 8) );
+	CHECK( badPool.firstBlock == nullptr );
+	CHECK( LLPD::sdram_arena_get_mark() == 0 );
+
+	// block sizes are rounded up to the alignment
+	SDRAM_POOL pool;
+	CHECK( LLPD::sdram_pool_init(pool, 10, 4, 16) );
+	CHECK( pool.blockSize == 16 && pool.numBlocks == 4 && pool.numFree == 4 );
+	CHECK( LLPD::sdram_arena_get_mark() == 64 );
+
+	// blocks come out lowest address first
+	void* blocks[4];
+	for ( unsigned int blockNum = 0; blockNum < 4; blockNum++ )
+	{
+		blocks[blockNum] = LLPD::sdram_pool_alloc( pool );
+		CHECK( blocks[blockNum] != nullptr && offsetOf(blocks[blockNum]) == blockNum * 16 );
+	}
+
+	// an empty pool returns nullptr
+	CHECK( pool.numFree == 0 );
+	CHECK( LLPD::sdram_pool_alloc(pool) == nullptr );
+
+	// freed blocks are reused most recently freed first
+	LLPD::sdram_pool_free( pool, blocks[1] );
+	LLPD::sdram_pool_free( pool, blocks[3] );
+	CHECK( pool.numFree == 2 );
+	CHECK( LLPD::sdram_pool_alloc(pool) == blocks[3] );
+	CHECK( LLPD::sdram_pool_alloc(pool) == blocks[1] );
+	CHECK( LLPD::sdram_pool_alloc(pool) == nullptr );
+
+	// a pool that doesn't fit in the arena fails without using memory
+	SDRAM_POOL bigPool;
+	const uint32_t used = LLPD::sdram_arena_get_mark();
+	CHECK( !LLPD::sdram_pool_init(bigPool, TEST_ARENA_SIZE, 2, 4) );
+	CHECK( !LLPD::sdram_pool_init(bigPool, UINT32_MAX / 2, 4, 4) );
+	CHECK( LLPD::sdram_arena_get_mark() == used );
+}
+
+static void testPoolFreeRejectsForeignPointers()
+{
+	resetArena();
+
+	void* before = LLPD::sdram_arena_alloc( 32 );
+
+	SDRAM_POOL pool;
+	CHECK( LLPD::sdram_pool_init(pool, 32, 2, 32) );
+
+	void* after = LLPD::sdram_arena_alloc( 32 );
+
+	SDRAM_POOL otherPool;
+	CHECK( LLPD::sdram_pool_init(otherPool, 32, 2, 32) );
+
+	uint8_t* first = static_cast<uint8_t*>( LLPD::sdram_pool_alloc(pool) );
+	uint8_t* second = static_cast<uint8_t*>( LLPD::sdram_pool_alloc(pool) );
+	uint8_t* otherBlock = static_cast<uint8_t*>( LLPD::sdram_pool_alloc(otherPool) );
+	CHECK( first != nullptr && second != nullptr && otherBlock != nullptr );
+	CHECK( pool.numFree == 0 );
+
+	uint32_t stackWord = 0;
+	void* foreignPtrs[7] = { before, after, otherBlock, &stackWord, first + 4, second + 31, second + 32 };
+	for ( void* foreignPtr : foreignPtrs )
+	{
+		LLPD::sdram_pool_free( pool, foreignPtr );
+		CHECK( pool.numFree == 0 );
+		CHECK( pool.freeList == nullptr );
+	}
+
+	// the real blocks still go back
+	LLPD::sdram_pool_free( pool, second );
+	CHECK( pool.numFree == 1 );
+	CHECK( LLPD::sdram_pool_alloc(pool) == second );
+}
+
+static void testInterruptMask()
+{
+	resetArena();
+	testNumIrqDisables = 0;
+
+	// the caller's mask is restored, whether interrupts were enabled or not
+	testPrimask = 0;
+	CHECK( LLPD::sdram_arena_alloc(4) != nullptr );
+	CHECK( testPrimask == 0 );
+
+	testPrimask = 1;
+	CHECK( LLPD::sdram_arena_alloc(4) != nullptr );
+	CHECK( testPrimask == 1 );
+
+	// failed allocations restore it too
+	testPrimask = 0;
+	CHECK( LLPD::sdram_arena_alloc(TEST_ARENA_SIZE) == nullptr );
+	CHECK( testPrimask == 0 );
+
+	CHECK( testNumIrqDisables == 3 );
+}
+
+int main()
+{
+	testBuffer = static_cast<uint8_t*>( aligned_alloc(TEST_BANK_ALIGNMENT, TEST_ARENA_SIZE) );
+	if ( testBuffer == nullptr )
+	{
+		printf( "couldn't allocate the test buffer\n" );
+		return 1;
+	}
+	testSdramBankAddresses[static_cast<unsigned int>( FMC_SDRAM_BANK::BANK_5 )] = reinterpret_cast<uintptr_t>( testBuffer );
+
+	testAlignment();
+	testExhaustion();
+	testMarkAndReset();
+	testPool();
+	testPoolFreeRejectsForeignPointers();
+	testInterruptMask();
+
+	free( testBuffer );
+
+	if ( numFailures != 0 )
+	{
+		printf( "%u checks failed\n", numFailures );
+		return 1;
+	}
+
+	printf( "all checks passed\n" );
+	return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef LLPD_H
+#define LLPD_H
+
+// host stand-in for include/LLPD.hpp, with just what the sources under test need. The types below are copied from
+// include/LLPD.hpp and need to be kept in sync with it
+
+#include <stdint.h>
+
+// the arena and pools mask interrupts around updates, on the host these just track the mask so the tests can check it
+extern uint32_t testPrimask;
+extern unsigned int testNumIrqDisables;
+
+inline uint32_t __get_PRIMASK()
+{
+	return testPrimask;
+}
+
+inline void __set_PRIMASK (const uint32_t primask)
+{
+	testPrimask = primask;
+}
+
+inline void __disable_irq()
+{
+	testPrimask = 1;
+	testNumIrqDisables++;
+}
+
+enum class FMC_SDRAM_BANK
+{
+	BANK_5 = 0b0,
+	BANK_6 = 0b1
+};
+
+// the tests point the banks at heap buffers instead of the fmc address space
+extern uintptr_t testSdramBankAddresses[2];
+
+inline uintptr_t fmc_sdram_bank_address (const FMC_SDRAM_BANK& bank)
+{
+	return testSdramBankAddresses[static_cast<unsigned int>( bank )];
+}
+
+constexpr uint32_t CACHE_LINE_SIZE = 32;
+
+constexpr uint32_t SDRAM_ARENA_MIN_ALIGNMENT = 4;
+
+struct SDRAM_POOL
+{
+	uint8_t* 	firstBlock = nullptr;
+	uint8_t* 	freeList   = nullptr;
+	uint32_t 	blockSize  = 0;
+	uint32_t 	numBlocks  = 0;
+	uint32_t 	numFree    = 0;
+};
+
+class LLPD
+{
+	public:
+		// SDRAM arena
+		static void sdram_arena_init (const FMC_SDRAM_BANK& bank, const uint32_t sizeInBytes);
+		static void* sdram_arena_alloc (const uint32_t numBytes, const uint32_t alignment = SDRAM_ARENA_MIN_ALIGNMENT);
+		static uint32_t sdram_arena_get_mark();
+		static void sdram_arena_reset (const uint32_t mark = 0);
+		static uint32_t sdram_arena_get_free_bytes();
+		static bool sdram_pool_init (SDRAM_POOL& pool, const uint32_t blockSize, const uint32_t numBlocks,
+						const uint32_t alignment = CACHE_LINE_SIZE);
+		static void* sdram_pool_alloc (SDRAM_POOL& pool);
+		static void sdram_pool_free (SDRAM_POOL& pool, void* block);
+};
+
+#endif // LLPD_H
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""
+Lists what landed in the cortex-m7 tightly coupled memories from a GNU ld map file (link with -Wl,-Map=<file>.map).
+
+usage: tcm_map_report.py <file>.map
+"""
+
+import re
+import sys
+
+TCM_SECTIONS = ( ".itcm_text", ".dtcm_data", ".dtcm_bss" )
+TCM_LENGTHS = { ".itcm_text": 64 * 1024, ".dtcm_data": 128 * 1024, ".dtcm_bss": 128 * 1024 }
+
+OUTPUT_SECTION = re.compile( r"^(\.\S+)\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)(?:\s+load address\s+(0x[0-9a-fA-F]+))?" )
+INPUT_SECTION = re.compile( r"^ (\.\S+)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(.+))?$" )
+INPUT_SECTION_WRAPPED = re.compile( r"^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(.+)$" )
+SYMBOL = re.compile( r"^\s+(0x[0-9a-fA-F]+)\s+([^=\s].*)$" )
+
+def parse_map (lines):
+	sections = {}
+	current = None
+	pendingInputName = None
+
+	for line in lines:
+		line = line.rstrip( "\n" )
+
+		match = OUTPUT_SECTION.match( line )
+		if match:
+			name = match.group( 1 )
+			current = None
+			if name in TCM_SECTIONS:
+				current = { "address": int(match.group(2), 16), "size": int(match.group(3), 16),
+						"load": int(match.group(4), 16) if match.group(4) else None, "inputs": [] }
+				sections[name] = current
+			continue
+
+		# anything else starting in the first column ends the output section
+		if line and not line[0].isspace():
+			current = None
+			continue
+
+		if current is None:
+			continue
+
+		match = INPUT_SECTION.match( line )
+		if match:
+			if match.group( 2 ):
+				current["inputs"].append( { "address": int(match.group(2), 16), "size": int(match.group(3), 16),
+								"object": match.group(4).strip(), "symbols": [] } )
+			else:
+				# long input section names put the address, size and object on the next line
+				pendingInputName = match.group( 1 )
+			continue
+
+		if pendingInputName is not None:
+			pendingInputName = None
+			match = INPUT_SECTION_WRAPPED.match( line )
+			if match:
+				current["inputs"].append( { "address": int(match.group(1), 16), "size": int(match.group(2), 16),
+								"object": match.group(3).strip(), "symbols": [] } )
+				continue
+
+		# linker script assignments also show up with an address, so only symbols inside the last input section count
+		match = SYMBOL.match( line )
+		if match and current["inputs"] and "=" not in match.group( 2 ):
+			inputSection = current["inputs"][-1]
+			address = int( match.group(1), 16 )
+			if inputSection["address"] <= address < inputSection["address"] + inputSection["size"]:
+				inputSection["symbols"].append( (address, match.group(2).strip()) )
+
+	return sections
+
+def print_report (sections):
+	for name in TCM_SECTIONS:
+		section = sections.get( name )
+		if section is None:
+			print( "%s: not in map file" % name )
+			continue
+
+		loadText = "" if section["load"] is None else ", loaded from 0x%08x" % section["load"]
+		print( "%s: 0x%08x, %d bytes (%.1f%% of %d KB)%s" % (name, section["address"], section["size"],
+				100.0 * section["size"] / TCM_LENGTHS[name], TCM_LENGTHS[name] // 1024, loadText) )
+
+		for inputSection in section["inputs"]:
+			if inputSection["size"] == 0:
+				continue
+
+			print( "    %s (%d bytes)" % (inputSection["object"], inputSection["size"]) )
+
+			# symbol sizes run to the next symbol or the end of the input section
+			symbols = sorted( inputSection["symbols"] )
+			inputEnd = inputSection["address"] + inputSection["size"]
+			for index, (address, symbolName) in enumerate( symbols ):
+				nextAddress = symbols[index + 1][0] if index + 1 < len( symbols ) else inputEnd
+				print( "        0x%08x %6d  %s" % (address, nextAddress - address, symbolName) )
+
+if __name__ == "__main__":
+	if len( sys.argv ) != 2:
+		print( __doc__.strip() )
+		sys.exit( 1 )
+
+	with open( sys.argv[1] ) as mapFile:
+		print_report( parse_map(mapFile) )